@@ -2,10 +2,22 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
+#include <thread>
 
 #if defined(__linux__)
 #include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #elif defined(__MACH__)
 #include <mach/mach_time.h>
 #elif defined(_WIN32)
@@ -36,6 +48,106 @@ uint64_t nanotime() {
 #include "rapidjson/error/en.h"
 #include "gason.h"
 
+// Hardware counters of the benchmark thread around every timed trial. Counters which
+// can't be opened (no perf_event, perf_event_paranoid, VM without PMU) read zero.
+struct Counters {
+    enum {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        CACHE_MISSES,
+        COUNT
+    };
+    int fds[COUNT];
+    bool enabled;
+
+    Counters()
+        : enabled(false) {
+        for (auto &fd : fds)
+            fd = -1;
+    }
+    ~Counters() {
+#if defined(__linux__)
+        for (auto fd : fds)
+            if (fd != -1)
+                close(fd);
+#endif
+    }
+    // True if at least cycles can be counted, the rest join their group
+    bool open() {
+#if defined(__linux__)
+        static const uint64_t events[COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                                               PERF_COUNT_HW_CACHE_MISSES};
+        for (int i = 0; i < COUNT; ++i) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = events[i];
+            attr.disabled = i == 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+            if (fds[0] == -1)
+                return false;
+        }
+        return enabled = true;
+#else
+        return false;
+#endif
+    }
+    void start() {
+#if defined(__linux__)
+        if (!enabled)
+            return;
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+    // Adds counts since start() to sums
+    void stop(uint64_t *sums) {
+#if defined(__linux__)
+        if (!enabled)
+            return;
+        ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (int i = 0; i < COUNT; ++i) {
+            uint64_t value;
+            if (fds[i] != -1 && read(fds[i], &value, sizeof(value)) == sizeof(value))
+                sums[i] += value;
+        }
+#else
+        (void)sums;
+#endif
+    }
+};
+
+static Counters counters;
+
+// Zones which gason allocators of the rows get, counted by their backing
+struct ZoneStats {
+    size_t zones;
+    size_t bytes;
+    size_t live;
+    size_t peak;
+};
+
+static ZoneStats zoneStats;
+
+static void *countingAllocate(size_t size, void *) {
+    zoneStats.zones++;
+    zoneStats.bytes += size;
+    zoneStats.live += size;
+    zoneStats.peak = std::max(zoneStats.peak, zoneStats.live);
+    return malloc(size);
+}
+
+static void countingFree(void *p, size_t size, void *) {
+    zoneStats.live -= size;
+    free(p);
+}
+
+static const JsonBacking countingBacking = {countingAllocate, countingFree, nullptr};
+
 struct Stat {
     size_t numberCount;
     size_t stringCount;
@@ -45,17 +157,33 @@ struct Stat {
     size_t trueCount;
     size_t nullCount;
     size_t sourceSize;
-    uint64_t parseTime;
-    uint64_t updateTime;
+    size_t trials;
+    uint64_t parseMedian;
+    uint64_t parseP99;
+    uint64_t updateMedian;
+    // per trial, for parsers whose memory is counted
+    bool counted;
+    double zones;
+    double zoneBytes;
+    size_t peak;
+    uint64_t counters[Counters::COUNT];
     const char *parserName;
+    const char *error;
 };
 
+// Every row gets its source in prepare() before the clock starts, copying it if parse()
+// writes into it; parse() alone is timed, then update() walks the result for counts.
 struct Rapid {
     rapidjson::Document doc;
+    const char *data;
+    static const bool counted = false;
 
-    bool parse(const std::vector<char> &buffer) {
-        doc.Parse(buffer.data());
-        return doc.HasParseError();
+    void prepare(const char *data, size_t) {
+        this->data = data;
+    }
+    bool parse() {
+        doc.Parse(data);
+        return !doc.HasParseError();
     }
     const char *strError() {
         return rapidjson::GetParseError_En(doc.GetParseError());
@@ -103,10 +231,12 @@ struct Rapid {
 struct RapidInsitu : Rapid {
     std::vector<char> source;
 
-    bool parse(const std::vector<char> &buffer) {
-        source = buffer;
+    void prepare(const char *data, size_t size) {
+        source.assign(data, data + size + 1);
+    }
+    bool parse() {
         doc.ParseInsitu(source.data());
-        return doc.HasParseError();
+        return !doc.HasParseError();
     }
     static const char *name() {
         return "rapid insitu";
@@ -115,13 +245,16 @@ struct RapidInsitu : Rapid {
 
 struct Gason {
     std::vector<char> source;
-    JsonAllocator allocator;
+    JsonAllocator allocator{JSON_ZONE_SIZE, JSON_MAX_ZONE_SIZE, countingBacking};
     JsonValue value;
     char *endptr;
     int result;
+    static const bool counted = true;
 
-    bool parse(const std::vector<char> &buffer) {
-        source = buffer;
+    void prepare(const char *data, size_t size) {
+        source.assign(data, data + size + 1);
+    }
+    bool parse() {
         return (result = jsonParse(source.data(), &endptr, &value, allocator)) == JSON_OK;
     }
     const char *strError() {
@@ -149,6 +282,7 @@ struct Gason {
             stat.stringCount++;
             break;
         case JSON_NUMBER:
+        case JSON_INTEGER:
             stat.numberCount++;
             break;
         case JSON_TRUE:
@@ -167,32 +301,350 @@ struct Gason {
     }
 };
 
-template <typename T>
-static Stat run(size_t iterations, const std::vector<char> &buffer) {
+// Two-stage parse over SIMD token index
+struct GasonIndexed : Gason {
+    bool parse() {
+        return (result = jsonParse(source.data(), &endptr, &value, allocator, JSON_PARSE_INDEXED)) == JSON_OK;
+    }
+    static const char *name() {
+        return "gason indexed";
+    }
+};
+
+struct GasonNondestructive : Gason {
+    const char *data;
+    size_t size;
+
+    void prepare(const char *data, size_t size) {
+        this->data = data;
+        this->size = size;
+    }
+    bool parse() {
+        return (result = jsonParse((char *)data, &endptr, &value, allocator, JSON_PARSE_NONDESTRUCTIVE)) == JSON_OK;
+    }
+    static const char *name() {
+        return "gason nondestructive";
+    }
+};
+
+struct GasonContiguous : Gason {
+    bool parse() {
+        return (result = jsonParse(source.data(), &endptr, &value, allocator, JSON_PARSE_CONTIGUOUS)) == JSON_OK;
+    }
+    static const char *name() {
+        return "gason contiguous";
+    }
+};
+
+// Counts during parse, no tree is built
+struct GasonSax : Gason {
+    struct Counter : JsonSaxHandler {
+        Stat stat;
+
+        void onNull() {
+            stat.nullCount++;
+        }
+        void onBool(bool b) {
+            b ? stat.trueCount++ : stat.falseCount++;
+        }
+        void onNumber(double) {
+            stat.numberCount++;
+        }
+        void onString(char *, size_t) {
+            stat.stringCount++;
+        }
+        void onKey(char *, size_t) {
+            stat.stringCount++;
+        }
+        void onStartArray() {
+            stat.arrayCount++;
+        }
+        void onStartObject() {
+            stat.objectCount++;
+        }
+    };
+    JsonSaxParser parser;
+    Counter counter;
+
+    void prepare(const char *data, size_t size) {
+        source.assign(data, data + size);
+        memset(&counter.stat, 0, sizeof(counter.stat));
+    }
+    bool parse() {
+        return (result = parser.parse(source.data(), source.data() + source.size(), &endptr, counter, allocator)) == JSON_OK;
+    }
+    void update(Stat &stat) {
+        stat.numberCount += counter.stat.numberCount;
+        stat.stringCount += counter.stat.stringCount;
+        stat.objectCount += counter.stat.objectCount;
+        stat.arrayCount += counter.stat.arrayCount;
+        stat.falseCount += counter.stat.falseCount;
+        stat.trueCount += counter.stat.trueCount;
+        stat.nullCount += counter.stat.nullCount;
+    }
+    static const char *name() {
+        return "gason sax";
+    }
+};
+
+// Checks read-only source in place, nothing to count
+struct GasonValidate : GasonNondestructive {
+    bool parse() {
+        const char *end;
+        return (result = jsonValidate(data, data + size, &end)) == JSON_OK;
+    }
+    void update(Stat &) {
+    }
+    static const char *name() {
+        return "gason validate";
+    }
+};
+
+// Skims elements or members of read-only root, skipping everything inside them, so only
+// they are counted
+struct GasonLazy : GasonNondestructive {
     Stat stat;
-    memset(&stat, 0, sizeof(stat));
 
-    std::vector<T> docs(iterations);
+    bool parse() {
+        memset(&stat, 0, sizeof(stat));
+        JsonLazy root((char *)data, (char *)data + size);
+        if (!root.valid() || (root.getTag() != JSON_ARRAY && root.getTag() != JSON_OBJECT))
+            return false;
+        for (JsonLazy i = root.first(); i.valid(); i = i.next()) {
+            switch (i.getTag()) {
+            case JSON_ARRAY:
+                stat.arrayCount++;
+                break;
+            case JSON_OBJECT:
+                stat.objectCount++;
+                break;
+            case JSON_STRING:
+                stat.stringCount++;
+                break;
+            case JSON_TRUE:
+                stat.trueCount++;
+                break;
+            case JSON_FALSE:
+                stat.falseCount++;
+                break;
+            case JSON_NULL:
+                stat.nullCount++;
+                break;
+            default:
+                stat.numberCount++;
+                break;
+            }
+        }
+        return true;
+    }
+    const char *strError() {
+        return "root is not array or object";
+    }
+    void update(Stat &stat) {
+        stat.numberCount += this->stat.numberCount;
+        stat.stringCount += this->stat.stringCount;
+        stat.objectCount += this->stat.objectCount;
+        stat.arrayCount += this->stat.arrayCount;
+        stat.falseCount += this->stat.falseCount;
+        stat.trueCount += this->stat.trueCount;
+        stat.nullCount += this->stat.nullCount;
+    }
+    static const char *name() {
+        return "gason lazy top level";
+    }
+};
+
+struct GasonLines : Gason {
+    JsonDocument *documents;
+    size_t count;
 
-    auto t = nanotime();
-    for (auto &i : docs) {
-        i.parse(buffer);
+    void prepare(const char *data, size_t size) {
+        source.assign(data, data + size);
+    }
+    bool parse() {
+        return (result = jsonParseDocuments(source.data(), source.data() + source.size(), &documents, &count, allocator, JSON_PARSE_LINES)) == JSON_OK;
+    }
+    void update(Stat &stat) {
+        for (size_t i = 0; i < count; ++i)
+            if (documents[i].status == JSON_OK)
+                genStat(stat, documents[i].value);
     }
-    stat.parseTime += nanotime() - t;
+    static const char *name() {
+        return "gason lines";
+    }
+};
 
-    t = nanotime();
-    for (auto &i : docs)
-        i.update(stat);
-    stat.updateTime += nanotime() - t;
+// Workers have allocators of their own, so these rows have no zone counts
+template <int Threads>
+struct GasonParallel : GasonLines {
+    JsonParallelParser parser{Threads};
+    static const bool counted = false;
 
-    stat.sourceSize = buffer.size() * iterations;
-    stat.parserName = T::name();
+    bool parse() {
+        return (result = parser.parse(source.data(), source.data() + source.size(), &documents, &count)) == JSON_OK;
+    }
+    static const char *name() {
+        static char name[32];
+        snprintf(name, sizeof(name), "gason %d threads", Threads);
+        return name;
+    }
+};
+
+template <int Threads>
+struct GasonParallelArray : Gason {
+    JsonParallelParser parser{Threads};
+    static const bool counted = false;
+
+    void prepare(const char *data, size_t size) {
+        source.assign(data, data + size);
+    }
+    bool parse() {
+        return (result = parser.parseArray(source.data(), source.data() + source.size(), &endptr, &value)) == JSON_OK;
+    }
+    static const char *name() {
+        static char name[32];
+        snprintf(name, sizeof(name), "gason array %d threads", Threads);
+        return name;
+    }
+};
+
+struct Options {
+    size_t trials;
+    size_t warmup;
+};
+
+static uint64_t percentile(std::vector<uint64_t> &times, double p) {
+    std::sort(times.begin(), times.end());
+    size_t i = (size_t)(p * times.size());
+    return times[i < times.size() ? i : times.size() - 1];
+}
 
+// Warm-up trials, then timed ones, each with a fresh parser whose setup and teardown
+// are not timed; counts come from the first timed one
+template <typename T>
+static Stat run(const Options &options, const char *data, size_t size) {
+    Stat stat;
+    memset(&stat, 0, sizeof(stat));
+    std::vector<uint64_t> parseTimes, updateTimes;
+    ZoneStats zones = {0, 0, 0, 0};
+    for (size_t i = 0; i < options.warmup + options.trials; ++i) {
+        std::unique_ptr<T> doc(new T);
+        doc->prepare(data, size);
+        zoneStats = ZoneStats{0, 0, 0, 0};
+        uint64_t sums[Counters::COUNT] = {};
+        counters.start();
+        auto t = nanotime();
+        bool ok = doc->parse();
+        t = nanotime() - t;
+        counters.stop(sums);
+        if (!ok && !stat.error)
+            stat.error = doc->strError();
+        if (i < options.warmup)
+            continue;
+        parseTimes.push_back(t);
+        zones.zones += zoneStats.zones;
+        zones.bytes += zoneStats.bytes;
+        zones.peak = std::max(zones.peak, zoneStats.peak);
+        for (int j = 0; j < Counters::COUNT; ++j)
+            stat.counters[j] += sums[j];
+
+        Stat counts;
+        memset(&counts, 0, sizeof(counts));
+        t = nanotime();
+        doc->update(counts);
+        updateTimes.push_back(nanotime() - t);
+        if (i == options.warmup)
+            memcpy(&stat, &counts, offsetof(Stat, sourceSize));
+    }
+    stat.sourceSize = size;
+    stat.trials = options.trials;
+    stat.parseMedian = percentile(parseTimes, 0.5);
+    stat.parseP99 = percentile(parseTimes, 0.99);
+    stat.updateMedian = percentile(updateTimes, 0.5);
+    stat.zones = (double)zones.zones / options.trials;
+    stat.zoneBytes = (double)zones.bytes / options.trials;
+    stat.peak = zones.peak;
+    stat.counted = T::counted;
+    stat.parserName = T::name();
     return stat;
 }
 
+static void printHeader() {
+    printf("%7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s", "Number", "String", "Object", "Array", "False", "True", "Null",
+           "Size", "Update", "Parse", "P99", "Speed", "Zones", "ZoneMiB", "PeakMiB");
+    if (counters.enabled)
+        printf(" %7s %7s %7s %7s", "Cyc/B", "IPC", "BrM/KiB", "CM/KiB");
+    printf("\n");
+}
+
+// Speed of gason rows against stored one, lines of "input<TAB>parser<TAB>MB/s": -B records
+// it, -b compares with it and counts rows over tolerance percent slower as regressions.
+struct Baseline {
+    struct Entry {
+        std::string input;
+        std::string parser;
+        double speed;
+    };
+    std::vector<Entry> entries;
+    FILE *record;
+    double tolerance;
+    std::string input;
+    int regressions;
+
+    Baseline()
+        : record(nullptr), tolerance(10), regressions(0) {
+    }
+    ~Baseline() {
+        if (record)
+            fclose(record);
+    }
+    bool load(const char *path) {
+        FILE *f = fopen(path, "r");
+        if (!f)
+            return false;
+        char line[1024];
+        while (fgets(line, sizeof(line), f)) {
+            char *parser = strchr(line, '\t');
+            char *speed = parser ? strchr(parser + 1, '\t') : nullptr;
+            if (!speed)
+                continue;
+            entries.push_back({std::string(line, parser), std::string(parser + 1, speed), strtod(speed + 1, NULL)});
+        }
+        fclose(f);
+        return true;
+    }
+    // Inputs are told apart by file name only, so baseline is valid in any checkout
+    void setInput(const char *path) {
+        const char *slash = strrchr(path, '/');
+        input = slash ? slash + 1 : path;
+    }
+    void track(const Stat &stat, double speed) {
+        if (strncmp(stat.parserName, "gason", 5) || stat.error)
+            return;
+        if (record) {
+            fprintf(record, "%s\t%s\t%.2f\n", input.c_str(), stat.parserName, speed);
+            return;
+        }
+        for (auto &entry : entries) {
+            if (entry.input != input || entry.parser != stat.parserName)
+                continue;
+            double change = (speed / entry.speed - 1) * 100;
+            if (change < -tolerance) {
+                fprintf(stderr, "REGRESSION %s, %s: %.2f MB/s, baseline %.2f MB/s (%.1f%%)\n", input.c_str(), stat.parserName, speed,
+                        entry.speed, change);
+                regressions++;
+            }
+            return;
+        }
+    }
+};
+
+static Baseline baseline;
+
 static void print(const Stat &stat) {
-    printf("%7zd %7zd %7zd %7zd %7zd %7zd %7zd %7.2f %7.2f %7.2f %7.2f %s\n",
+    double speed = stat.sourceSize / (stat.parseMedian / 1e9) / 1048576.0;
+    baseline.track(stat, speed);
+    printf("%7zd %7zd %7zd %7zd %7zd %7zd %7zd %7.2f %7.2f %7.2f %7.2f %7.2f",
            stat.numberCount,
            stat.stringCount,
            stat.objectCount,
@@ -201,10 +653,114 @@ static void print(const Stat &stat) {
            stat.trueCount,
            stat.nullCount,
            stat.sourceSize / 1048576.0,
-           stat.updateTime / 1e6,
-           stat.parseTime / 1e6,
-           stat.sourceSize / (stat.parseTime / 1e9) / 1048576.0,
-           stat.parserName);
+           stat.updateMedian / 1e6,
+           stat.parseMedian / 1e6,
+           stat.parseP99 / 1e6,
+           speed);
+    if (stat.counted)
+        printf(" %7.1f %7.2f %7.2f", stat.zones, stat.zoneBytes / 1048576.0, stat.peak / 1048576.0);
+    else
+        printf(" %7c %7c %7c", '-', '-', '-');
+    if (counters.enabled) {
+        const uint64_t *c = stat.counters;
+        double bytes = (double)stat.sourceSize * stat.trials;
+        double ipc = c[Counters::CYCLES] ? (double)c[Counters::INSTRUCTIONS] / c[Counters::CYCLES] : 0;
+        printf(" %7.2f %7.2f %7.2f %7.2f", c[Counters::CYCLES] / bytes, ipc, c[Counters::BRANCH_MISSES] / bytes * 1024,
+               c[Counters::CACHE_MISSES] / bytes * 1024);
+    }
+    printf(" %s", stat.parserName);
+    if (stat.error)
+        printf(" (%s)", stat.error);
+    printf("\n");
+}
+
+template <template <int> class T>
+static void runThreads(const Options &options, const char *data, size_t size, unsigned int threads) {
+    print(run<T<1>>(options, data, size));
+    if (threads >= 2)
+        print(run<T<2>>(options, data, size));
+    if (threads >= 4)
+        print(run<T<4>>(options, data, size));
+    if (threads >= 8)
+        print(run<T<8>>(options, data, size));
+    if (threads >= 16)
+        print(run<T<16>>(options, data, size));
+    if (threads >= 32)
+        print(run<T<32>>(options, data, size));
+    if (threads >= 64)
+        print(run<T<64>>(options, data, size));
+}
+
+// Fixed seed, so generated documents are the same every run
+static uint64_t random64() {
+    static uint64_t state = 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static void appendf(std::string &s, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendf(std::string &s, const char *format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    s.append(buffer, n);
+}
+
+static void appendRecord(std::string &s, uint64_t id) {
+    static const char *names[] = {"alpha", "beta", "gamma \\\"quoted\\\"", "d\\u00e9lta", "\xD1\x8D\xD0\xBF\xD1\x81\xD0\xB8\xD0\xBB\xD0\xBE\xD0\xBD"};
+    uint64_t r = random64();
+    appendf(s, "{\"id\": %llu, \"name\": \"%s\", \"score\": %.6g, \"active\": %s, \"tags\": [\"t%u\", \"t%u\"], \"parent\": %s}",
+            (unsigned long long)id, names[r % 5], (double)(r >> 11) / (1ULL << 40), r & 32 ? "true" : "false", (unsigned)(r >> 20) % 100,
+            (unsigned)(r >> 30) % 100, r & 64 ? "null" : "{\"id\": 0, \"depth\": 1}");
+}
+
+// Synthetic document of about size bytes: numbers, strings, objects (array of records),
+// lines (JSON Lines of records, for -l) or deep (array of 64 levels deep nestings).
+// Followed by JSON_PADDING zero bytes like jsonMapFile result; nullptr for unknown kind.
+static char *generate(const char *kind, size_t size, size_t *length) {
+    bool lines = !strcmp(kind, "lines");
+    if (!lines && strcmp(kind, "numbers") && strcmp(kind, "strings") && strcmp(kind, "objects") && strcmp(kind, "deep"))
+        return nullptr;
+    std::string s;
+    s.reserve(size + 256);
+    if (!lines)
+        s += '[';
+    for (uint64_t i = 0; s.size() < size; ++i) {
+        if (i && !lines)
+            s += ", ";
+        uint64_t r = random64();
+        if (!strcmp(kind, "numbers")) {
+            if (r & 1)
+                appendf(s, "%lld", (long long)(r >> 20) - (1LL << 43));
+            else
+                appendf(s, "%.17g", (double)(r >> 11) / (1ULL << 53) * pow(10, (int)(r & 0x3F) - 32));
+        } else if (!strcmp(kind, "strings")) {
+            appendf(s, "\"plain ascii %llu\", \"tab\\tnew\\nline \\\"q\\\" \\\\ \\u00e9\\u4e2d\", \"\xD1\x8E\xD0\xBD\xD0\xB8\xD0\xBA\xD0\xBE\xD0\xB4 %u\"",
+                    (unsigned long long)r, (unsigned)i);
+        } else if (!strcmp(kind, "deep")) {
+            for (int j = 0; j < 64; ++j)
+                s += j % 2 ? "{\"k\": " : "[";
+            appendf(s, "%u", (unsigned)i);
+            for (int j = 64; j-- > 0;)
+                s += j % 2 ? '}' : ']';
+        } else {
+            appendRecord(s, i);
+            if (lines)
+                s += '\n';
+        }
+    }
+    if (!lines)
+        s += ']';
+    char *data = (char *)calloc(s.size() + JSON_PADDING, 1);
+    if (data)
+        memcpy(data, s.data(), s.size());
+    *length = s.size();
+    return data;
 }
 
 #if defined(__clang__)
@@ -224,34 +780,124 @@ static void print(const Stat &stat) {
 int main(int argc, const char **argv) {
     printf("gason benchmark, %s, x86_64 %d, SIZEOF_POINTER %d, NDEBUG %d\n", COMPILER, __x86_64__, __SIZEOF_POINTER__, NDEBUG);
 
-    printf("%7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s\n",
-           "Number", "String", "Object", "Array", "False", "True", "Null", "Size", "Update", "Parse", "Speed");
-
-    size_t iterations = 10;
+    Options options = {10, 2};
+    bool lines = false;
+    bool array = false;
+    unsigned int threads = std::thread::hardware_concurrency();
     for (int i = 1; i < argc; ++i) {
-        if (!strcmp("-n", argv[i])) {
-            iterations = strtol(argv[++i], NULL, 0);
+        // timed trials, medians and 99th percentiles are over them
+        if (!strcmp("-n", argv[i]) && i + 1 < argc) {
+            options.trials = std::max(1L, strtol(argv[++i], NULL, 0));
+            continue;
+        }
+        // untimed trials before them
+        if (!strcmp("-w", argv[i]) && i + 1 < argc) {
+            options.warmup = strtol(argv[++i], NULL, 0);
+            continue;
+        }
+        // pins benchmark to given CPU, threads of parallel rows inherit it
+        if (!strcmp("-c", argv[i]) && i + 1 < argc) {
+            int cpu = strtol(argv[++i], NULL, 0);
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (sched_setaffinity(0, sizeof(set), &set) != 0)
+                perror("sched_setaffinity");
+#else
+            fprintf(stderr, "-c %d: pinning is supported on Linux only\n", cpu);
+#endif
+            continue;
+        }
+        // hardware counters: cycles per byte, IPC, branch and cache misses per KiB
+        if (!strcmp("-p", argv[i])) {
+            if (!counters.open())
+                fprintf(stderr, "-p: hardware counters are not available\n");
+            continue;
+        }
+        // records speed of gason rows to the file given
+        if (!strcmp("-B", argv[i]) && i + 1 < argc) {
+            if (!(baseline.record = fopen(argv[++i], "w"))) {
+                perror(argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+        // compares speed of gason rows with the file given, exit status is failure if any is slower
+        if (!strcmp("-b", argv[i]) && i + 1 < argc) {
+            if (!baseline.load(argv[++i])) {
+                perror(argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+        // percents slower than baseline which are still no regression, 10 by default
+        if (!strcmp("-t", argv[i]) && i + 1 < argc) {
+            baseline.tolerance = strtod(argv[++i], NULL);
+            continue;
+        }
+        // following files are JSON Lines, parsed one and many threads at a time
+        if (!strcmp("-l", argv[i])) {
+            lines = true;
+            continue;
+        }
+        // following files are single huge arrays, parsed one and many threads at a time
+        if (!strcmp("-a", argv[i])) {
+            array = true;
             continue;
         }
 
-        FILE *fp = fopen(argv[i], "r");
-        if (!fp) {
-            perror(argv[i]);
-            exit(EXIT_FAILURE);
+        size_t size;
+        char *data;
+        // synthetic document instead of file, -g kind:MiB (16 MiB by default)
+        bool generated = !strcmp("-g", argv[i]) && i + 1 < argc;
+        if (generated) {
+            const char *spec = argv[++i];
+            const char *colon = strchr(spec, ':');
+            std::string kind(spec, colon ? colon - spec : strlen(spec));
+            data = generate(kind.c_str(), (colon ? strtoul(colon + 1, NULL, 0) : 16) << 20, &size);
+            if (!data) {
+                fprintf(stderr, "%s: unknown kind, one of numbers, strings, objects, lines, deep\n", spec);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            // read-only mapping, parsers which modify source make their own copy
+            data = jsonMapFile(argv[i], &size, false);
+            if (!data) {
+                perror(argv[i]);
+                exit(EXIT_FAILURE);
+            }
         }
-        fseek(fp, 0, SEEK_END);
-        size_t size = ftell(fp);
-        fseek(fp, 0, SEEK_SET);
-        std::vector<char> buffer;
-        buffer.resize(size + 1);
-        fread(buffer.data(), 1, size, fp);
-        fclose(fp);
-
-        printf("%7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %s, %zd x %zd\n",
-               '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', argv[i], size, iterations);
-        print(run<Rapid>(iterations, buffer));
-        print(run<RapidInsitu>(iterations, buffer));
-        print(run<Gason>(iterations, buffer));
+
+        baseline.setInput(argv[i]);
+        printHeader();
+        printf("%7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %7c %s, %zd x %zd + %zd warm-up\n",
+               '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', '-', argv[i], size, options.trials, options.warmup);
+        if (lines) {
+            print(run<GasonLines>(options, data, size));
+            runThreads<GasonParallel>(options, data, size, threads);
+        } else if (array) {
+            print(run<Gason>(options, data, size));
+            runThreads<GasonParallelArray>(options, data, size, threads);
+        } else {
+            print(run<Rapid>(options, data, size));
+            print(run<RapidInsitu>(options, data, size));
+            print(run<Gason>(options, data, size));
+            print(run<GasonIndexed>(options, data, size));
+            print(run<GasonNondestructive>(options, data, size));
+            print(run<GasonContiguous>(options, data, size));
+            print(run<GasonSax>(options, data, size));
+            print(run<GasonValidate>(options, data, size));
+            print(run<GasonLazy>(options, data, size));
+        }
+        if (generated)
+            free(data);
+        else
+            jsonUnmapFile(data, size);
+    }
+    if (baseline.regressions) {
+        fprintf(stderr, "%d rows regressed over %g%%\n", baseline.regressions, baseline.tolerance);
+        return EXIT_FAILURE;
     }
     return 0;
 }
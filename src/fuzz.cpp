@@ -0,0 +1,160 @@
+#include "gason.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Differential check of parse modes: all of them get the same bytes and must agree with
+// plain bounded jsonParse on status, error position and, on success, the tree. Entry point
+// of libFuzzer target (cmake -DGASON_FUZZ=ON with clang), test-suite runs it on its cases.
+
+static bool equal(JsonValue a, JsonValue b) {
+    if (a.getTag() != b.getTag())
+        return false;
+    switch (a.getTag()) {
+    case JSON_NUMBER:
+        return a.toNumber() == b.toNumber();
+    case JSON_INTEGER:
+        return a.toInteger() == b.toInteger();
+    case JSON_STRING:
+        return !strcmp(a.toString(), b.toString());
+    case JSON_ARRAY:
+    case JSON_OBJECT: {
+        JsonNode *i = a.toNode(), *j = b.toNode();
+        for (; i && j; i = i->next, j = j->next)
+            if (!equal(i->value, j->value) || (a.getTag() == JSON_OBJECT && strcmp(i->key, j->key)))
+                return false;
+        return !i && !j;
+    }
+    default:
+        return true;
+    }
+}
+
+// Copy of input without terminator, so reading past the end is caught by sanitizers;
+// padded slack is filled with digits, so missing terminator breaks trailing numbers
+struct Source {
+    char *begin;
+    char *end;
+
+    Source(const char *data, size_t size, size_t slack = 0)
+        : begin((char *)malloc(size + slack + 1)), end(begin + size) {
+        memcpy(begin, data, size);
+        memset(end, '7', slack);
+    }
+    Source(const Source &) = delete;
+    Source &operator=(const Source &) = delete;
+    ~Source() {
+        free(begin);
+    }
+};
+
+struct Reference {
+    const char *data;
+    size_t size;
+    int status;
+    size_t offset;
+    JsonValue value;
+};
+
+// Mode result against reference, printed with input if they differ
+static bool agree(const Reference &reference, const char *mode, int status, size_t offset, JsonValue value, bool exact = true) {
+    if (exact ? status == reference.status && offset == reference.offset : !status == !reference.status) {
+        if (status || equal(value, reference.value))
+            return true;
+        fprintf(stderr, "%s: tree differs\n", mode);
+    } else {
+        fprintf(stderr, "%s: %s at %zu, reference %s at %zu\n", mode, jsonStrError(status), offset, jsonStrError(reference.status), reference.offset);
+    }
+    fprintf(stderr, "%.*s\n", (int)reference.size, reference.data);
+    return false;
+}
+
+static bool bounded(const Reference &reference, const char *mode, int flags) {
+    Source source(reference.data, reference.size, flags & JSON_PARSE_PADDED ? JSON_PADDING : 0);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int status = jsonParse(source.begin, source.end, &endptr, &value, allocator, flags);
+    return agree(reference, mode, status, endptr - source.begin, value);
+}
+
+// Terminated source ends at the first NUL, so only input without one is comparable. String
+// running into the end fails bounded parse, terminated one ends it at NUL instead.
+static bool terminated(const Reference &reference, const char *mode, int flags) {
+    if (memchr(reference.data, 0, reference.size))
+        return true;
+    if (reference.status == JSON_BAD_STRING && reference.offset == reference.size)
+        return true;
+    Source source(reference.data, reference.size, 1);
+    *source.end = 0;
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int status = jsonParse(source.begin, &endptr, &value, allocator, flags);
+    return agree(reference, mode, status, endptr - source.begin, value);
+}
+
+// Stream parser reports no error position of its own, only success has to match
+static bool stream(const Reference &reference, const char *mode, size_t chunk) {
+    Source source(reference.data, reference.size);
+    JsonValue value;
+    JsonAllocator allocator;
+    JsonStreamParser parser(allocator);
+    int status = JSON_OK;
+    for (size_t i = 0; i < reference.size && !status; i += chunk)
+        status = parser.feed(source.begin + i, i + chunk < reference.size ? chunk : reference.size - i);
+    if (!status)
+        status = parser.finish(&value);
+    return agree(reference, mode, status, 0, value, false);
+}
+
+static bool validate(const Reference &reference, const char *mode, int flags) {
+    Source source(reference.data, reference.size);
+    const char *endptr;
+    int status = jsonValidate(source.begin, source.end, &endptr, flags);
+    if (memcmp(source.begin, reference.data, reference.size)) {
+        fprintf(stderr, "%s: source modified\n", mode);
+        return false;
+    }
+    return agree(reference, mode, status, endptr - source.begin, reference.value);
+}
+
+static bool parallel(const Reference &reference, const char *mode, int threads) {
+    Source source(reference.data, reference.size);
+    char *endptr;
+    JsonValue value;
+    JsonParallelParser parser(threads);
+    int status = parser.parseArray(source.begin, source.end, &endptr, &value);
+    return agree(reference, mode, status, endptr - source.begin, value);
+}
+
+bool differential(const char *data, size_t size) {
+    Source source(data, size);
+    char *endptr;
+    JsonAllocator allocator;
+    Reference reference = {data, size, JSON_OK, 0, JsonValue()};
+    reference.status = jsonParse(source.begin, source.end, &endptr, &reference.value, allocator);
+    reference.offset = endptr - source.begin;
+
+    return bounded(reference, "indexed", JSON_PARSE_INDEXED) &&
+           bounded(reference, "padded", JSON_PARSE_PADDED) &&
+           bounded(reference, "padded indexed", JSON_PARSE_PADDED | JSON_PARSE_INDEXED) &&
+           bounded(reference, "nondestructive", JSON_PARSE_NONDESTRUCTIVE) &&
+           bounded(reference, "contiguous", JSON_PARSE_CONTIGUOUS) &&
+           bounded(reference, "contiguous indexed", JSON_PARSE_CONTIGUOUS | JSON_PARSE_INDEXED) &&
+           bounded(reference, "intern keys", JSON_PARSE_INTERN_KEYS) &&
+           bounded(reference, "string lengths", JSON_PARSE_STRING_LENGTHS) &&
+           terminated(reference, "terminated", 0) &&
+           terminated(reference, "terminated indexed", JSON_PARSE_INDEXED) &&
+           stream(reference, "stream by 1", 1) &&
+           stream(reference, "stream by 7", 7) &&
+           validate(reference, "validate", 0) &&
+           validate(reference, "validate indexed", JSON_PARSE_INDEXED) &&
+           parallel(reference, "parallel array", 2);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (!differential((const char *)data, size))
+        abort();
+    return 0;
+}
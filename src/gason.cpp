@@ -1,8 +1,56 @@
 #include "gason.h"
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include <stdio.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
-#define JSON_ZONE_SIZE 4096
-#define JSON_STACK_SIZE 32
+// Streaming parse ran out of input, unparsed bytes start at *endptr
+#define JSON_INCOMPLETE -1
+
+// 1 - numbers are correctly rounded, hard cases fall back to strtod
+// 0 - fastest, numbers with over 19 significant digits may be off by one ulp
+#ifndef JSON_EXACT_NUMBERS
+#define JSON_EXACT_NUMBERS 1
+#endif
+
+// Wide loads may read past the end of source (never across a page), sanitizers report
+// that, so sanitized builds take the byte at a time paths.
+#ifndef JSON_NO_OVERREAD
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define JSON_NO_OVERREAD 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define JSON_NO_OVERREAD 1
+#endif
+#endif
+#endif
+#ifndef JSON_NO_OVERREAD
+#define JSON_NO_OVERREAD 0
+#endif
+
+// 1 - parses and allocators fill JsonStats given to JsonAllocator::setStats()
+// 0 - fastest, nothing is counted and stats stay zero
+#ifndef JSON_STATS
+#define JSON_STATS 0
+#endif
 
 const char *jsonStrError(int err) {
     switch (err) {
@@ -16,36 +64,244 @@ const char *jsonStrError(int err) {
     }
 }
 
+static void *mallocAllocate(size_t size, void *) {
+    return malloc(size);
+}
+
+static void mallocFree(void *p, size_t, void *) {
+    free(p);
+}
+
+const JsonBacking jsonMallocBacking = {mallocAllocate, mallocFree, nullptr};
+
+#if defined(__unix__) || defined(__APPLE__)
+static size_t mmapSize(size_t size) {
+    size_t page = size < JSON_HUGE_PAGE_SIZE ? (size_t)sysconf(_SC_PAGESIZE) : JSON_HUGE_PAGE_SIZE;
+    return (size + page - 1) & ~(page - 1);
+}
+
+static void *mmapAllocate(size_t size, void *) {
+    size = mmapSize(size);
+    void *p = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if (size >= JSON_HUGE_PAGE_SIZE)
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+#if defined(MADV_HUGEPAGE)
+        if (size >= JSON_HUGE_PAGE_SIZE)
+            madvise(p, size, MADV_HUGEPAGE);
+#endif
+    }
+    return p;
+}
+
+static void mmapFree(void *p, size_t size, void *) {
+    munmap(p, mmapSize(size));
+}
+
+const JsonBacking jsonMmapBacking = {mmapAllocate, mmapFree, nullptr};
+#else
+const JsonBacking jsonMmapBacking = {mallocAllocate, mallocFree, nullptr};
+#endif
+
+JsonAllocator::JsonAllocator(void *p, size_t size, size_t zoneSize, size_t maxZoneSize, const JsonBacking &backing)
+    : head(nullptr), large(nullptr), buffer(nullptr), zoneSize(zoneSize), maxZoneSize(maxZoneSize), backing(&backing), internSlots(nullptr), internMask(0), internCount(0), stats(nullptr) {
+    char *aligned = (char *)(((uintptr_t)p + 7) & ~(uintptr_t)7);
+    if (size >= (size_t)(aligned - (char *)p) + sizeof(Zone)) {
+        buffer = (Zone *)aligned;
+        buffer->size = size - (aligned - (char *)p);
+        buffer->used = sizeof(Zone);
+        buffer->next = nullptr;
+        head = buffer;
+    }
+}
+
+JsonAllocator::Zone *JsonAllocator::allocateZone(size_t size) {
+    Zone *zone = (Zone *)backing->allocate(size, backing->context);
+    if (zone == nullptr)
+        return nullptr;
+    zone->size = size;
+    if (JSON_STATS && stats) {
+        stats->zones++;
+        stats->zoneBytes += size;
+    }
+    return zone;
+}
+
+void JsonAllocator::freeZones(Zone *zone) {
+    while (zone) {
+        Zone *next = zone->next;
+        if (zone != buffer)
+            backing->free(zone, zone->size, backing->context);
+        zone = next;
+    }
+}
+
 void *JsonAllocator::allocate(size_t size) {
     size = (size + 7) & ~7;
 
-    if (head && head->used + size <= JSON_ZONE_SIZE) {
+    if (head && head->used + size <= head->size) {
         char *p = (char *)head + head->used;
         head->used += size;
         return p;
     }
 
     size_t allocSize = sizeof(Zone) + size;
-    Zone *zone = (Zone *)malloc(allocSize <= JSON_ZONE_SIZE ? JSON_ZONE_SIZE : allocSize);
+    if (allocSize > zoneSize) {
+        Zone *block = allocateZone(allocSize);
+        if (block == nullptr)
+            return nullptr;
+        if (JSON_STATS && stats) {
+            stats->oversized++;
+            stats->oversizedBytes += allocSize;
+        }
+        block->used = allocSize;
+        block->next = large;
+        large = block;
+        return (char *)block + sizeof(Zone);
+    }
+
+    Zone *zone = allocateZone(zoneSize);
     if (zone == nullptr)
         return nullptr;
     zone->used = allocSize;
-    if (allocSize <= JSON_ZONE_SIZE || head == nullptr) {
-        zone->next = head;
-        head = zone;
-    } else {
-        zone->next = head->next;
-        head->next = zone;
-    }
+    zone->next = head;
+    head = zone;
+    if (zoneSize < maxZoneSize)
+        zoneSize = zoneSize * 2 < maxZoneSize ? zoneSize * 2 : maxZoneSize;
     return (char *)zone + sizeof(Zone);
 }
 
+bool JsonAllocator::reserve(size_t size) {
+    size = (size + 7) & ~7;
+    if (head && head->used + size <= head->size)
+        return true;
+
+    size_t allocSize = sizeof(Zone) + size;
+    Zone *zone = allocateZone(allocSize < zoneSize ? zoneSize : allocSize);
+    if (zone == nullptr)
+        return false;
+    zone->used = sizeof(Zone);
+    zone->next = head;
+    head = zone;
+    return true;
+}
+
+void JsonAllocator::reset(size_t trimSize) {
+    size_t total = 0;
+    Zone **largest = nullptr;
+    for (Zone **it = &head; *it; it = &(*it)->next) {
+        total += (*it)->used - sizeof(Zone);
+        if (!largest || (*it)->size > (*largest)->size)
+            largest = it;
+    }
+    for (Zone *it = large; it; it = it->next)
+        total += it->used - sizeof(Zone);
+
+    Zone *keep = nullptr;
+    if (largest && (*largest)->size - sizeof(Zone) >= total && (*largest)->size <= trimSize) {
+        keep = *largest;
+        *largest = keep->next;
+    }
+    deallocate();
+    if (!keep && total && sizeof(Zone) + total <= trimSize)
+        keep = allocateZone(sizeof(Zone) + total);
+    if (keep && keep != buffer) {
+        keep->next = head;
+        keep->used = sizeof(Zone);
+        head = keep;
+    }
+}
+
 void JsonAllocator::deallocate() {
-    while (head) {
-        Zone *next = head->next;
-        free(head);
-        head = next;
+    freeZones(head);
+    freeZones(large);
+    head = large = nullptr;
+    internSlots = nullptr;
+    internMask = internCount = 0;
+    if (buffer) {
+        buffer->next = nullptr;
+        buffer->used = sizeof(Zone);
+        head = buffer;
+    }
+}
+
+// Eight bytes at a time, multiply and rotate
+static inline uint64_t hashBytes(const char *s, size_t length) {
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    uint64_t hash = length * k;
+    uint64_t word;
+    for (; length >= 8; s += 8, length -= 8) {
+        memcpy(&word, s, 8);
+        hash = ((hash ^ word) * k);
+        hash ^= hash >> 29;
+    }
+    word = 0;
+    memcpy(&word, s, length);
+    hash = (hash ^ word) * k;
+    return hash ^ (hash >> 32);
+}
+
+// Copy in allocator with length before it, as JSON_PARSE_STRING_LENGTHS strings have
+static char *copyString(const char *s, size_t length, JsonAllocator &allocator) {
+    char *copy = (char *)allocator.allocate(sizeof(size_t) + length + 1);
+    if (copy == nullptr)
+        return nullptr;
+    *(size_t *)copy = length;
+    copy += sizeof(size_t);
+    memcpy(copy, s, length);
+    copy[length] = 0;
+    return copy;
+}
+
+struct JsonAllocator::InternSlot {
+    uint64_t hash;
+    size_t length;
+    char *s;
+};
+
+char *JsonAllocator::intern(const char *s, size_t length) {
+    // table is at most half full
+    if (2 * internCount >= internMask) {
+        size_t capacity = internMask ? 2 * (internMask + 1) : 256;
+        InternSlot *slots = (InternSlot *)allocate(capacity * sizeof(InternSlot));
+        if (slots == nullptr)
+            return nullptr;
+        memset(slots, 0, capacity * sizeof(InternSlot));
+        for (size_t i = 0; internSlots && i <= internMask; ++i) {
+            if (!internSlots[i].s)
+                continue;
+            size_t j = internSlots[i].hash & (capacity - 1);
+            while (slots[j].s)
+                j = (j + 1) & (capacity - 1);
+            slots[j] = internSlots[i];
+        }
+        internSlots = slots;
+        internMask = capacity - 1;
     }
+
+    uint64_t hash = hashBytes(s, length);
+    size_t i = hash & internMask;
+    for (; internSlots[i].s; i = (i + 1) & internMask) {
+        InternSlot &slot = internSlots[i];
+        if (slot.hash == hash && slot.length == length && !memcmp(slot.s, s, length))
+            return slot.s;
+    }
+    // with length before it, so interned keys have it without JSON_PARSE_STRING_LENGTHS too
+    char *copy = copyString(s, length, *this);
+    if (copy == nullptr)
+        return nullptr;
+    internSlots[i] = InternSlot{hash, length, copy};
+    ++internCount;
+    return copy;
+}
+
+char *JsonAllocator::intern(const char *s) {
+    return intern(s, strlen(s));
 }
 
 static inline bool isspace(char c) {
@@ -70,50 +326,671 @@ static inline int char2int(char c) {
     return (c & ~' ') - 'A' + 10;
 }
 
-static double string2double(char *s, char **endptr) {
-    char ch = *s;
-    if (ch == '-')
-        ++s;
+// Byte at s, bounded source reads as terminated at end.
+template <bool Bounded>
+static inline char peek(const char *s, const char *end) {
+    return Bounded && s >= end ? 0 : *s;
+}
 
-    double result = 0;
-    while (isdigit(*s))
-        result = (result * 10) + (*s++ - '0');
+static inline bool isstrspecial(char c) {
+    return c == '"' || c == '\\' || (unsigned char)c < ' ' || c == '\x7F';
+}
 
-    if (*s == '.') {
+// Skips string bytes which need no attention: returns pointer to the first '"', '\\',
+// control character or DEL (including terminating '\0'), bounded one stops at end too.
+// Wide loads are aligned, so they never cross a page boundary even when reading past
+// the terminator.
+template <bool Bounded>
+static inline char *scanString(char *s, char *end) {
+#if JSON_NO_OVERREAD
+    while ((!Bounded || s < end) && !isstrspecial(*s))
         ++s;
+    return s;
+#elif defined(__AVX2__)
+    for (; (uintptr_t)s & 31; ++s)
+        if ((Bounded && s >= end) || isstrspecial(*s))
+            return s;
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    for (; !Bounded || s < end; s += 32) {
+        __m256i x = _mm256_load_si256((const __m256i *)s);
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(x, control), control), _mm256_cmpeq_epi8(x, del)));
+        unsigned int mask = _mm256_movemask_epi8(m);
+        if (mask)
+            return Bounded && s + __builtin_ctz(mask) > end ? end : s + __builtin_ctz(mask);
+    }
+    return end;
+#elif defined(__SSE2__)
+    for (; (uintptr_t)s & 15; ++s)
+        if ((Bounded && s >= end) || isstrspecial(*s))
+            return s;
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    for (; !Bounded || s < end; s += 16) {
+        __m128i x = _mm_load_si128((const __m128i *)s);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(x, control), control), _mm_cmpeq_epi8(x, del)));
+        unsigned int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return Bounded && s + __builtin_ctz(mask) > end ? end : s + __builtin_ctz(mask);
+    }
+    return end;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; (uintptr_t)s & 15; ++s)
+        if ((Bounded && s >= end) || isstrspecial(*s))
+            return s;
+    for (; !Bounded || s < end; s += 16) {
+        uint8x16_t x = vld1q_u8((const uint8_t *)s);
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(x, vdupq_n_u8('"')), vceqq_u8(x, vdupq_n_u8('\\'))),
+                                vorrq_u8(vcltq_u8(x, vdupq_n_u8(' ')), vceqq_u8(x, vdupq_n_u8(0x7F))));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask)
+            return Bounded && s + (__builtin_ctzll(mask) >> 2) > end ? end : s + (__builtin_ctzll(mask) >> 2);
+    }
+    return end;
+#else
+    while ((!Bounded || s < end) && !isstrspecial(*s))
+        ++s;
+    return s;
+#endif
+}
+
+// Finds closing quote of a string (or terminator) without decoding it.
+template <bool Bounded>
+static inline char *stringEnd(char *s, char *end) {
+    for (;; ++s) {
+        s = scanString<Bounded>(s, end);
+        if (peek<Bounded>(s, end) == '"' || !peek<Bounded>(s, end))
+            return s;
+        if (*s == '\\' && peek<Bounded>(s + 1, end))
+            ++s;
+    }
+}
+
+// Truncated 128-bit powers of five from 5^-342 to 5^308 for Eisel-Lemire, high word first.
+static const uint64_t powersOf5[] = {
+    0xEEF453D6923BD65A, 0x113FAA2906A13B3F, 0x9558B4661B6565F8, 0x4AC7CA59A424C507,
+    0xBAAEE17FA23EBF76, 0x5D79BCF00D2DF649, 0xE95A99DF8ACE6F53, 0xF4D82C2C107973DC,
+    0x91D8A02BB6C10594, 0x79071B9B8A4BE869, 0xB64EC836A47146F9, 0x9748E2826CDEE284,
+    0xE3E27A444D8D98B7, 0xFD1B1B2308169B25, 0x8E6D8C6AB0787F72, 0xFE30F0F5E50E20F7,
+    0xB208EF855C969F4F, 0xBDBD2D335E51A935, 0xDE8B2B66B3BC4723, 0xAD2C788035E61382,
+    0x8B16FB203055AC76, 0x4C3BCB5021AFCC31, 0xADDCB9E83C6B1793, 0xDF4ABE242A1BBF3D,
+    0xD953E8624B85DD78, 0xD71D6DAD34A2AF0D, 0x87D4713D6F33AA6B, 0x8672648C40E5AD68,
+    0xA9C98D8CCB009506, 0x680EFDAF511F18C2, 0xD43BF0EFFDC0BA48, 0x0212BD1B2566DEF2,
+    0x84A57695FE98746D, 0x014BB630F7604B57, 0xA5CED43B7E3E9188, 0x419EA3BD35385E2D,
+    0xCF42894A5DCE35EA, 0x52064CAC828675B9, 0x818995CE7AA0E1B2, 0x7343EFEBD1940993,
+    0xA1EBFB4219491A1F, 0x1014EBE6C5F90BF8, 0xCA66FA129F9B60A6, 0xD41A26E077774EF6,
+    0xFD00B897478238D0, 0x8920B098955522B4, 0x9E20735E8CB16382, 0x55B46E5F5D5535B0,
+    0xC5A890362FDDBC62, 0xEB2189F734AA831D, 0xF712B443BBD52B7B, 0xA5E9EC7501D523E4,
+    0x9A6BB0AA55653B2D, 0x47B233C92125366E, 0xC1069CD4EABE89F8, 0x999EC0BB696E840A,
+    0xF148440A256E2C76, 0xC00670EA43CA250D, 0x96CD2A865764DBCA, 0x380406926A5E5728,
+    0xBC807527ED3E12BC, 0xC605083704F5ECF2, 0xEBA09271E88D976B, 0xF7864A44C633682E,
+    0x93445B8731587EA3, 0x7AB3EE6AFBE0211D, 0xB8157268FDAE9E4C, 0x5960EA05BAD82964,
+    0xE61ACF033D1A45DF, 0x6FB92487298E33BD, 0x8FD0C16206306BAB, 0xA5D3B6D479F8E056,
+    0xB3C4F1BA87BC8696, 0x8F48A4899877186C, 0xE0B62E2929ABA83C, 0x331ACDABFE94DE87,
+    0x8C71DCD9BA0B4925, 0x9FF0C08B7F1D0B14, 0xAF8E5410288E1B6F, 0x07ECF0AE5EE44DD9,
+    0xDB71E91432B1A24A, 0xC9E82CD9F69D6150, 0x892731AC9FAF056E, 0xBE311C083A225CD2,
+    0xAB70FE17C79AC6CA, 0x6DBD630A48AAF406, 0xD64D3D9DB981787D, 0x092CBBCCDAD5B108,
+    0x85F0468293F0EB4E, 0x25BBF56008C58EA5, 0xA76C582338ED2621, 0xAF2AF2B80AF6F24E,
+    0xD1476E2C07286FAA, 0x1AF5AF660DB4AEE1, 0x82CCA4DB847945CA, 0x50D98D9FC890ED4D,
+    0xA37FCE126597973C, 0xE50FF107BAB528A0, 0xCC5FC196FEFD7D0C, 0x1E53ED49A96272C8,
+    0xFF77B1FCBEBCDC4F, 0x25E8E89C13BB0F7A, 0x9FAACF3DF73609B1, 0x77B191618C54E9AC,
+    0xC795830D75038C1D, 0xD59DF5B9EF6A2417, 0xF97AE3D0D2446F25, 0x4B0573286B44AD1D,
+    0x9BECCE62836AC577, 0x4EE367F9430AEC32, 0xC2E801FB244576D5, 0x229C41F793CDA73F,
+    0xF3A20279ED56D48A, 0x6B43527578C1110F, 0x9845418C345644D6, 0x830A13896B78AAA9,
+    0xBE5691EF416BD60C, 0x23CC986BC656D553, 0xEDEC366B11C6CB8F, 0x2CBFBE86B7EC8AA8,
+    0x94B3A202EB1C3F39, 0x7BF7D71432F3D6A9, 0xB9E08A83A5E34F07, 0xDAF5CCD93FB0CC53,
+    0xE858AD248F5C22C9, 0xD1B3400F8F9CFF68, 0x91376C36D99995BE, 0x23100809B9C21FA1,
+    0xB58547448FFFFB2D, 0xABD40A0C2832A78A, 0xE2E69915B3FFF9F9, 0x16C90C8F323F516C,
+    0x8DD01FAD907FFC3B, 0xAE3DA7D97F6792E3, 0xB1442798F49FFB4A, 0x99CD11CFDF41779C,
+    0xDD95317F31C7FA1D, 0x40405643D711D583, 0x8A7D3EEF7F1CFC52, 0x482835EA666B2572,
+    0xAD1C8EAB5EE43B66, 0xDA3243650005EECF, 0xD863B256369D4A40, 0x90BED43E40076A82,
+    0x873E4F75E2224E68, 0x5A7744A6E804A291, 0xA90DE3535AAAE202, 0x711515D0A205CB36,
+    0xD3515C2831559A83, 0x0D5A5B44CA873E03, 0x8412D9991ED58091, 0xE858790AFE9486C2,
+    0xA5178FFF668AE0B6, 0x626E974DBE39A872, 0xCE5D73FF402D98E3, 0xFB0A3D212DC8128F,
+    0x80FA687F881C7F8E, 0x7CE66634BC9D0B99, 0xA139029F6A239F72, 0x1C1FFFC1EBC44E80,
+    0xC987434744AC874E, 0xA327FFB266B56220, 0xFBE9141915D7A922, 0x4BF1FF9F0062BAA8,
+    0x9D71AC8FADA6C9B5, 0x6F773FC3603DB4A9, 0xC4CE17B399107C22, 0xCB550FB4384D21D3,
+    0xF6019DA07F549B2B, 0x7E2A53A146606A48, 0x99C102844F94E0FB, 0x2EDA7444CBFC426D,
+    0xC0314325637A1939, 0xFA911155FEFB5308, 0xF03D93EEBC589F88, 0x793555AB7EBA27CA,
+    0x96267C7535B763B5, 0x4BC1558B2F3458DE, 0xBBB01B9283253CA2, 0x9EB1AAEDFB016F16,
+    0xEA9C227723EE8BCB, 0x465E15A979C1CADC, 0x92A1958A7675175F, 0x0BFACD89EC191EC9,
+    0xB749FAED14125D36, 0xCEF980EC671F667B, 0xE51C79A85916F484, 0x82B7E12780E7401A,
+    0x8F31CC0937AE58D2, 0xD1B2ECB8B0908810, 0xB2FE3F0B8599EF07, 0x861FA7E6DCB4AA15,
+    0xDFBDCECE67006AC9, 0x67A791E093E1D49A, 0x8BD6A141006042BD, 0xE0C8BB2C5C6D24E0,
+    0xAECC49914078536D, 0x58FAE9F773886E18, 0xDA7F5BF590966848, 0xAF39A475506A899E,
+    0x888F99797A5E012D, 0x6D8406C952429603, 0xAAB37FD7D8F58178, 0xC8E5087BA6D33B83,
+    0xD5605FCDCF32E1D6, 0xFB1E4A9A90880A64, 0x855C3BE0A17FCD26, 0x5CF2EEA09A55067F,
+    0xA6B34AD8C9DFC06F, 0xF42FAA48C0EA481E, 0xD0601D8EFC57B08B, 0xF13B94DAF124DA26,
+    0x823C12795DB6CE57, 0x76C53D08D6B70858, 0xA2CB1717B52481ED, 0x54768C4B0C64CA6E,
+    0xCB7DDCDDA26DA268, 0xA9942F5DCF7DFD09, 0xFE5D54150B090B02, 0xD3F93B35435D7C4C,
+    0x9EFA548D26E5A6E1, 0xC47BC5014A1A6DAF, 0xC6B8E9B0709F109A, 0x359AB6419CA1091B,
+    0xF867241C8CC6D4C0, 0xC30163D203C94B62, 0x9B407691D7FC44F8, 0x79E0DE63425DCF1D,
+    0xC21094364DFB5636, 0x985915FC12F542E4, 0xF294B943E17A2BC4, 0x3E6F5B7B17B2939D,
+    0x979CF3CA6CEC5B5A, 0xA705992CEECF9C42, 0xBD8430BD08277231, 0x50C6FF782A838353,
+    0xECE53CEC4A314EBD, 0xA4F8BF5635246428, 0x940F4613AE5ED136, 0x871B7795E136BE99,
+    0xB913179899F68584, 0x28E2557B59846E3F, 0xE757DD7EC07426E5, 0x331AEADA2FE589CF,
+    0x9096EA6F3848984F, 0x3FF0D2C85DEF7621, 0xB4BCA50B065ABE63, 0x0FED077A756B53A9,
+    0xE1EBCE4DC7F16DFB, 0xD3E8495912C62894, 0x8D3360F09CF6E4BD, 0x64712DD7ABBBD95C,
+    0xB080392CC4349DEC, 0xBD8D794D96AACFB3, 0xDCA04777F541C567, 0xECF0D7A0FC5583A0,
+    0x89E42CAAF9491B60, 0xF41686C49DB57244, 0xAC5D37D5B79B6239, 0x311C2875C522CED5,
+    0xD77485CB25823AC7, 0x7D633293366B828B, 0x86A8D39EF77164BC, 0xAE5DFF9C02033197,
+    0xA8530886B54DBDEB, 0xD9F57F830283FDFC, 0xD267CAA862A12D66, 0xD072DF63C324FD7B,
+    0x8380DEA93DA4BC60, 0x4247CB9E59F71E6D, 0xA46116538D0DEB78, 0x52D9BE85F074E608,
+    0xCD795BE870516656, 0x67902E276C921F8B, 0x806BD9714632DFF6, 0x00BA1CD8A3DB53B6,
+    0xA086CFCD97BF97F3, 0x80E8A40ECCD228A4, 0xC8A883C0FDAF7DF0, 0x6122CD128006B2CD,
+    0xFAD2A4B13D1B5D6C, 0x796B805720085F81, 0x9CC3A6EEC6311A63, 0xCBE3303674053BB0,
+    0xC3F490AA77BD60FC, 0xBEDBFC4411068A9C, 0xF4F1B4D515ACB93B, 0xEE92FB5515482D44,
+    0x991711052D8BF3C5, 0x751BDD152D4D1C4A, 0xBF5CD54678EEF0B6, 0xD262D45A78A0635D,
+    0xEF340A98172AACE4, 0x86FB897116C87C34, 0x9580869F0E7AAC0E, 0xD45D35E6AE3D4DA0,
+    0xBAE0A846D2195712, 0x8974836059CCA109, 0xE998D258869FACD7, 0x2BD1A438703FC94B,
+    0x91FF83775423CC06, 0x7B6306A34627DDCF, 0xB67F6455292CBF08, 0x1A3BC84C17B1D542,
+    0xE41F3D6A7377EECA, 0x20CABA5F1D9E4A93, 0x8E938662882AF53E, 0x547EB47B7282EE9C,
+    0xB23867FB2A35B28D, 0xE99E619A4F23AA43, 0xDEC681F9F4C31F31, 0x6405FA00E2EC94D4,
+    0x8B3C113C38F9F37E, 0xDE83BC408DD3DD04, 0xAE0B158B4738705E, 0x9624AB50B148D445,
+    0xD98DDAEE19068C76, 0x3BADD624DD9B0957, 0x87F8A8D4CFA417C9, 0xE54CA5D70A80E5D6,
+    0xA9F6D30A038D1DBC, 0x5E9FCF4CCD211F4C, 0xD47487CC8470652B, 0x7647C3200069671F,
+    0x84C8D4DFD2C63F3B, 0x29ECD9F40041E073, 0xA5FB0A17C777CF09, 0xF468107100525890,
+    0xCF79CC9DB955C2CC, 0x7182148D4066EEB4, 0x81AC1FE293D599BF, 0xC6F14CD848405530,
+    0xA21727DB38CB002F, 0xB8ADA00E5A506A7C, 0xCA9CF1D206FDC03B, 0xA6D90811F0E4851C,
+    0xFD442E4688BD304A, 0x908F4A166D1DA663, 0x9E4A9CEC15763E2E, 0x9A598E4E043287FE,
+    0xC5DD44271AD3CDBA, 0x40EFF1E1853F29FD, 0xF7549530E188C128, 0xD12BEE59E68EF47C,
+    0x9A94DD3E8CF578B9, 0x82BB74F8301958CE, 0xC13A148E3032D6E7, 0xE36A52363C1FAF01,
+    0xF18899B1BC3F8CA1, 0xDC44E6C3CB279AC1, 0x96F5600F15A7B7E5, 0x29AB103A5EF8C0B9,
+    0xBCB2B812DB11A5DE, 0x7415D448F6B6F0E7, 0xEBDF661791D60F56, 0x111B495B3464AD21,
+    0x936B9FCEBB25C995, 0xCAB10DD900BEEC34, 0xB84687C269EF3BFB, 0x3D5D514F40EEA742,
+    0xE65829B3046B0AFA, 0x0CB4A5A3112A5112, 0x8FF71A0FE2C2E6DC, 0x47F0E785EABA72AB,
+    0xB3F4E093DB73A093, 0x59ED216765690F56, 0xE0F218B8D25088B8, 0x306869C13EC3532C,
+    0x8C974F7383725573, 0x1E414218C73A13FB, 0xAFBD2350644EEACF, 0xE5D1929EF90898FA,
+    0xDBAC6C247D62A583, 0xDF45F746B74ABF39, 0x894BC396CE5DA772, 0x6B8BBA8C328EB783,
+    0xAB9EB47C81F5114F, 0x066EA92F3F326564, 0xD686619BA27255A2, 0xC80A537B0EFEFEBD,
+    0x8613FD0145877585, 0xBD06742CE95F5F36, 0xA798FC4196E952E7, 0x2C48113823B73704,
+    0xD17F3B51FCA3A7A0, 0xF75A15862CA504C5, 0x82EF85133DE648C4, 0x9A984D73DBE722FB,
+    0xA3AB66580D5FDAF5, 0xC13E60D0D2E0EBBA, 0xCC963FEE10B7D1B3, 0x318DF905079926A8,
+    0xFFBBCFE994E5C61F, 0xFDF17746497F7052, 0x9FD561F1FD0F9BD3, 0xFEB6EA8BEDEFA633,
+    0xC7CABA6E7C5382C8, 0xFE64A52EE96B8FC0, 0xF9BD690A1B68637B, 0x3DFDCE7AA3C673B0,
+    0x9C1661A651213E2D, 0x06BEA10CA65C084E, 0xC31BFA0FE5698DB8, 0x486E494FCFF30A62,
+    0xF3E2F893DEC3F126, 0x5A89DBA3C3EFCCFA, 0x986DDB5C6B3A76B7, 0xF89629465A75E01C,
+    0xBE89523386091465, 0xF6BBB397F1135823, 0xEE2BA6C0678B597F, 0x746AA07DED582E2C,
+    0x94DB483840B717EF, 0xA8C2A44EB4571CDC, 0xBA121A4650E4DDEB, 0x92F34D62616CE413,
+    0xE896A0D7E51E1566, 0x77B020BAF9C81D17, 0x915E2486EF32CD60, 0x0ACE1474DC1D122E,
+    0xB5B5ADA8AAFF80B8, 0x0D819992132456BA, 0xE3231912D5BF60E6, 0x10E1FFF697ED6C69,
+    0x8DF5EFABC5979C8F, 0xCA8D3FFA1EF463C1, 0xB1736B96B6FD83B3, 0xBD308FF8A6B17CB2,
+    0xDDD0467C64BCE4A0, 0xAC7CB3F6D05DDBDE, 0x8AA22C0DBEF60EE4, 0x6BCDF07A423AA96B,
+    0xAD4AB7112EB3929D, 0x86C16C98D2C953C6, 0xD89D64D57A607744, 0xE871C7BF077BA8B7,
+    0x87625F056C7C4A8B, 0x11471CD764AD4972, 0xA93AF6C6C79B5D2D, 0xD598E40D3DD89BCF,
+    0xD389B47879823479, 0x4AFF1D108D4EC2C3, 0x843610CB4BF160CB, 0xCEDF722A585139BA,
+    0xA54394FE1EEDB8FE, 0xC2974EB4EE658828, 0xCE947A3DA6A9273E, 0x733D226229FEEA32,
+    0x811CCC668829B887, 0x0806357D5A3F525F, 0xA163FF802A3426A8, 0xCA07C2DCB0CF26F7,
+    0xC9BCFF6034C13052, 0xFC89B393DD02F0B5, 0xFC2C3F3841F17C67, 0xBBAC2078D443ACE2,
+    0x9D9BA7832936EDC0, 0xD54B944B84AA4C0D, 0xC5029163F384A931, 0x0A9E795E65D4DF11,
+    0xF64335BCF065D37D, 0x4D4617B5FF4A16D5, 0x99EA0196163FA42E, 0x504BCED1BF8E4E45,
+    0xC06481FB9BCF8D39, 0xE45EC2862F71E1D6, 0xF07DA27A82C37088, 0x5D767327BB4E5A4C,
+    0x964E858C91BA2655, 0x3A6A07F8D510F86F, 0xBBE226EFB628AFEA, 0x890489F70A55368B,
+    0xEADAB0ABA3B2DBE5, 0x2B45AC74CCEA842E, 0x92C8AE6B464FC96F, 0x3B0B8BC90012929D,
+    0xB77ADA0617E3BBCB, 0x09CE6EBB40173744, 0xE55990879DDCAABD, 0xCC420A6A101D0515,
+    0x8F57FA54C2A9EAB6, 0x9FA946824A12232D, 0xB32DF8E9F3546564, 0x47939822DC96ABF9,
+    0xDFF9772470297EBD, 0x59787E2B93BC56F7, 0x8BFBEA76C619EF36, 0x57EB4EDB3C55B65A,
+    0xAEFAE51477A06B03, 0xEDE622920B6B23F1, 0xDAB99E59958885C4, 0xE95FAB368E45ECED,
+    0x88B402F7FD75539B, 0x11DBCB0218EBB414, 0xAAE103B5FCD2A881, 0xD652BDC29F26A119,
+    0xD59944A37C0752A2, 0x4BE76D3346F0495F, 0x857FCAE62D8493A5, 0x6F70A4400C562DDB,
+    0xA6DFBD9FB8E5B88E, 0xCB4CCD500F6BB952, 0xD097AD07A71F26B2, 0x7E2000A41346A7A7,
+    0x825ECC24C873782F, 0x8ED400668C0C28C8, 0xA2F67F2DFA90563B, 0x728900802F0F32FA,
+    0xCBB41EF979346BCA, 0x4F2B40A03AD2FFB9, 0xFEA126B7D78186BC, 0xE2F610C84987BFA8,
+    0x9F24B832E6B0F436, 0x0DD9CA7D2DF4D7C9, 0xC6EDE63FA05D3143, 0x91503D1C79720DBB,
+    0xF8A95FCF88747D94, 0x75A44C6397CE912A, 0x9B69DBE1B548CE7C, 0xC986AFBE3EE11ABA,
+    0xC24452DA229B021B, 0xFBE85BADCE996168, 0xF2D56790AB41C2A2, 0xFAE27299423FB9C3,
+    0x97C560BA6B0919A5, 0xDCCD879FC967D41A, 0xBDB6B8E905CB600F, 0x5400E987BBC1C920,
+    0xED246723473E3813, 0x290123E9AAB23B68, 0x9436C0760C86E30B, 0xF9A0B6720AAF6521,
+    0xB94470938FA89BCE, 0xF808E40E8D5B3E69, 0xE7958CB87392C2C2, 0xB60B1D1230B20E04,
+    0x90BD77F3483BB9B9, 0xB1C6F22B5E6F48C2, 0xB4ECD5F01A4AA828, 0x1E38AEB6360B1AF3,
+    0xE2280B6C20DD5232, 0x25C6DA63C38DE1B0, 0x8D590723948A535F, 0x579C487E5A38AD0E,
+    0xB0AF48EC79ACE837, 0x2D835A9DF0C6D851, 0xDCDB1B2798182244, 0xF8E431456CF88E65,
+    0x8A08F0F8BF0F156B, 0x1B8E9ECB641B58FF, 0xAC8B2D36EED2DAC5, 0xE272467E3D222F3F,
+    0xD7ADF884AA879177, 0x5B0ED81DCC6ABB0F, 0x86CCBB52EA94BAEA, 0x98E947129FC2B4E9,
+    0xA87FEA27A539E9A5, 0x3F2398D747B36224, 0xD29FE4B18E88640E, 0x8EEC7F0D19A03AAD,
+    0x83A3EEEEF9153E89, 0x1953CF68300424AC, 0xA48CEAAAB75A8E2B, 0x5FA8C3423C052DD7,
+    0xCDB02555653131B6, 0x3792F412CB06794D, 0x808E17555F3EBF11, 0xE2BBD88BBEE40BD0,
+    0xA0B19D2AB70E6ED6, 0x5B6ACEAEAE9D0EC4, 0xC8DE047564D20A8B, 0xF245825A5A445275,
+    0xFB158592BE068D2E, 0xEED6E2F0F0D56712, 0x9CED737BB6C4183D, 0x55464DD69685606B,
+    0xC428D05AA4751E4C, 0xAA97E14C3C26B886, 0xF53304714D9265DF, 0xD53DD99F4B3066A8,
+    0x993FE2C6D07B7FAB, 0xE546A8038EFE4029, 0xBF8FDB78849A5F96, 0xDE98520472BDD033,
+    0xEF73D256A5C0F77C, 0x963E66858F6D4440, 0x95A8637627989AAD, 0xDDE7001379A44AA8,
+    0xBB127C53B17EC159, 0x5560C018580D5D52, 0xE9D71B689DDE71AF, 0xAAB8F01E6E10B4A6,
+    0x9226712162AB070D, 0xCAB3961304CA70E8, 0xB6B00D69BB55C8D1, 0x3D607B97C5FD0D22,
+    0xE45C10C42A2B3B05, 0x8CB89A7DB77C506A, 0x8EB98A7A9A5B04E3, 0x77F3608E92ADB242,
+    0xB267ED1940F1C61C, 0x55F038B237591ED3, 0xDF01E85F912E37A3, 0x6B6C46DEC52F6688,
+    0x8B61313BBABCE2C6, 0x2323AC4B3B3DA015, 0xAE397D8AA96C1B77, 0xABEC975E0A0D081A,
+    0xD9C7DCED53C72255, 0x96E7BD358C904A21, 0x881CEA14545C7575, 0x7E50D64177DA2E54,
+    0xAA242499697392D2, 0xDDE50BD1D5D0B9E9, 0xD4AD2DBFC3D07787, 0x955E4EC64B44E864,
+    0x84EC3C97DA624AB4, 0xBD5AF13BEF0B113E, 0xA6274BBDD0FADD61, 0xECB1AD8AEACDD58E,
+    0xCFB11EAD453994BA, 0x67DE18EDA5814AF2, 0x81CEB32C4B43FCF4, 0x80EACF948770CED7,
+    0xA2425FF75E14FC31, 0xA1258379A94D028D, 0xCAD2F7F5359A3B3E, 0x096EE45813A04330,
+    0xFD87B5F28300CA0D, 0x8BCA9D6E188853FC, 0x9E74D1B791E07E48, 0x775EA264CF55347E,
+    0xC612062576589DDA, 0x95364AFE032A819E, 0xF79687AED3EEC551, 0x3A83DDBD83F52205,
+    0x9ABE14CD44753B52, 0xC4926A9672793543, 0xC16D9A0095928A27, 0x75B7053C0F178294,
+    0xF1C90080BAF72CB1, 0x5324C68B12DD6339, 0x971DA05074DA7BEE, 0xD3F6FC16EBCA5E04,
+    0xBCE5086492111AEA, 0x88F4BB1CA6BCF585, 0xEC1E4A7DB69561A5, 0x2B31E9E3D06C32E6,
+    0x9392EE8E921D5D07, 0x3AFF322E62439FD0, 0xB877AA3236A4B449, 0x09BEFEB9FAD487C3,
+    0xE69594BEC44DE15B, 0x4C2EBE687989A9B4, 0x901D7CF73AB0ACD9, 0x0F9D37014BF60A11,
+    0xB424DC35095CD80F, 0x538484C19EF38C95, 0xE12E13424BB40E13, 0x2865A5F206B06FBA,
+    0x8CBCCC096F5088CB, 0xF93F87B7442E45D4, 0xAFEBFF0BCB24AAFE, 0xF78F69A51539D749,
+    0xDBE6FECEBDEDD5BE, 0xB573440E5A884D1C, 0x89705F4136B4A597, 0x31680A88F8953031,
+    0xABCC77118461CEFC, 0xFDC20D2B36BA7C3E, 0xD6BF94D5E57A42BC, 0x3D32907604691B4D,
+    0x8637BD05AF6C69B5, 0xA63F9A49C2C1B110, 0xA7C5AC471B478423, 0x0FCF80DC33721D54,
+    0xD1B71758E219652B, 0xD3C36113404EA4A9, 0x83126E978D4FDF3B, 0x645A1CAC083126EA,
+    0xA3D70A3D70A3D70A, 0x3D70A3D70A3D70A4, 0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCD,
+    0x8000000000000000, 0x0000000000000000, 0xA000000000000000, 0x0000000000000000,
+    0xC800000000000000, 0x0000000000000000, 0xFA00000000000000, 0x0000000000000000,
+    0x9C40000000000000, 0x0000000000000000, 0xC350000000000000, 0x0000000000000000,
+    0xF424000000000000, 0x0000000000000000, 0x9896800000000000, 0x0000000000000000,
+    0xBEBC200000000000, 0x0000000000000000, 0xEE6B280000000000, 0x0000000000000000,
+    0x9502F90000000000, 0x0000000000000000, 0xBA43B74000000000, 0x0000000000000000,
+    0xE8D4A51000000000, 0x0000000000000000, 0x9184E72A00000000, 0x0000000000000000,
+    0xB5E620F480000000, 0x0000000000000000, 0xE35FA931A0000000, 0x0000000000000000,
+    0x8E1BC9BF04000000, 0x0000000000000000, 0xB1A2BC2EC5000000, 0x0000000000000000,
+    0xDE0B6B3A76400000, 0x0000000000000000, 0x8AC7230489E80000, 0x0000000000000000,
+    0xAD78EBC5AC620000, 0x0000000000000000, 0xD8D726B7177A8000, 0x0000000000000000,
+    0x878678326EAC9000, 0x0000000000000000, 0xA968163F0A57B400, 0x0000000000000000,
+    0xD3C21BCECCEDA100, 0x0000000000000000, 0x84595161401484A0, 0x0000000000000000,
+    0xA56FA5B99019A5C8, 0x0000000000000000, 0xCECB8F27F4200F3A, 0x0000000000000000,
+    0x813F3978F8940984, 0x4000000000000000, 0xA18F07D736B90BE5, 0x5000000000000000,
+    0xC9F2C9CD04674EDE, 0xA400000000000000, 0xFC6F7C4045812296, 0x4D00000000000000,
+    0x9DC5ADA82B70B59D, 0xF020000000000000, 0xC5371912364CE305, 0x6C28000000000000,
+    0xF684DF56C3E01BC6, 0xC732000000000000, 0x9A130B963A6C115C, 0x3C7F400000000000,
+    0xC097CE7BC90715B3, 0x4B9F100000000000, 0xF0BDC21ABB48DB20, 0x1E86D40000000000,
+    0x96769950B50D88F4, 0x1314448000000000, 0xBC143FA4E250EB31, 0x17D955A000000000,
+    0xEB194F8E1AE525FD, 0x5DCFAB0800000000, 0x92EFD1B8D0CF37BE, 0x5AA1CAE500000000,
+    0xB7ABC627050305AD, 0xF14A3D9E40000000, 0xE596B7B0C643C719, 0x6D9CCD05D0000000,
+    0x8F7E32CE7BEA5C6F, 0xE4820023A2000000, 0xB35DBF821AE4F38B, 0xDDA2802C8A800000,
+    0xE0352F62A19E306E, 0xD50B2037AD200000, 0x8C213D9DA502DE45, 0x4526F422CC340000,
+    0xAF298D050E4395D6, 0x9670B12B7F410000, 0xDAF3F04651D47B4C, 0x3C0CDD765F114000,
+    0x88D8762BF324CD0F, 0xA5880A69FB6AC800, 0xAB0E93B6EFEE0053, 0x8EEA0D047A457A00,
+    0xD5D238A4ABE98068, 0x72A4904598D6D880, 0x85A36366EB71F041, 0x47A6DA2B7F864750,
+    0xA70C3C40A64E6C51, 0x999090B65F67D924, 0xD0CF4B50CFE20765, 0xFFF4B4E3F741CF6D,
+    0x82818F1281ED449F, 0xBFF8F10E7A8921A4, 0xA321F2D7226895C7, 0xAFF72D52192B6A0D,
+    0xCBEA6F8CEB02BB39, 0x9BF4F8A69F764490, 0xFEE50B7025C36A08, 0x02F236D04753D5B4,
+    0x9F4F2726179A2245, 0x01D762422C946590, 0xC722F0EF9D80AAD6, 0x424D3AD2B7B97EF5,
+    0xF8EBAD2B84E0D58B, 0xD2E0898765A7DEB2, 0x9B934C3B330C8577, 0x63CC55F49F88EB2F,
+    0xC2781F49FFCFA6D5, 0x3CBF6B71C76B25FB, 0xF316271C7FC3908A, 0x8BEF464E3945EF7A,
+    0x97EDD871CFDA3A56, 0x97758BF0E3CBB5AC, 0xBDE94E8E43D0C8EC, 0x3D52EEED1CBEA317,
+    0xED63A231D4C4FB27, 0x4CA7AAA863EE4BDD, 0x945E455F24FB1CF8, 0x8FE8CAA93E74EF6A,
+    0xB975D6B6EE39E436, 0xB3E2FD538E122B44, 0xE7D34C64A9C85D44, 0x60DBBCA87196B616,
+    0x90E40FBEEA1D3A4A, 0xBC8955E946FE31CD, 0xB51D13AEA4A488DD, 0x6BABAB6398BDBE41,
+    0xE264589A4DCDAB14, 0xC696963C7EED2DD1, 0x8D7EB76070A08AEC, 0xFC1E1DE5CF543CA2,
+    0xB0DE65388CC8ADA8, 0x3B25A55F43294BCB, 0xDD15FE86AFFAD912, 0x49EF0EB713F39EBE,
+    0x8A2DBF142DFCC7AB, 0x6E3569326C784337, 0xACB92ED9397BF996, 0x49C2C37F07965404,
+    0xD7E77A8F87DAF7FB, 0xDC33745EC97BE906, 0x86F0AC99B4E8DAFD, 0x69A028BB3DED71A3,
+    0xA8ACD7C0222311BC, 0xC40832EA0D68CE0C, 0xD2D80DB02AABD62B, 0xF50A3FA490C30190,
+    0x83C7088E1AAB65DB, 0x792667C6DA79E0FA, 0xA4B8CAB1A1563F52, 0x577001B891185938,
+    0xCDE6FD5E09ABCF26, 0xED4C0226B55E6F86, 0x80B05E5AC60B6178, 0x544F8158315B05B4,
+    0xA0DC75F1778E39D6, 0x696361AE3DB1C721, 0xC913936DD571C84C, 0x03BC3A19CD1E38E9,
+    0xFB5878494ACE3A5F, 0x04AB48A04065C723, 0x9D174B2DCEC0E47B, 0x62EB0D64283F9C76,
+    0xC45D1DF942711D9A, 0x3BA5D0BD324F8394, 0xF5746577930D6500, 0xCA8F44EC7EE36479,
+    0x9968BF6ABBE85F20, 0x7E998B13CF4E1ECB, 0xBFC2EF456AE276E8, 0x9E3FEDD8C321A67E,
+    0xEFB3AB16C59B14A2, 0xC5CFE94EF3EA101E, 0x95D04AEE3B80ECE5, 0xBBA1F1D158724A12,
+    0xBB445DA9CA61281F, 0x2A8A6E45AE8EDC97, 0xEA1575143CF97226, 0xF52D09D71A3293BD,
+    0x924D692CA61BE758, 0x593C2626705F9C56, 0xB6E0C377CFA2E12E, 0x6F8B2FB00C77836C,
+    0xE498F455C38B997A, 0x0B6DFB9C0F956447, 0x8EDF98B59A373FEC, 0x4724BD4189BD5EAC,
+    0xB2977EE300C50FE7, 0x58EDEC91EC2CB657, 0xDF3D5E9BC0F653E1, 0x2F2967B66737E3ED,
+    0x8B865B215899F46C, 0xBD79E0D20082EE74, 0xAE67F1E9AEC07187, 0xECD8590680A3AA11,
+    0xDA01EE641A708DE9, 0xE80E6F4820CC9495, 0x884134FE908658B2, 0x3109058D147FDCDD,
+    0xAA51823E34A7EEDE, 0xBD4B46F0599FD415, 0xD4E5E2CDC1D1EA96, 0x6C9E18AC7007C91A,
+    0x850FADC09923329E, 0x03E2CF6BC604DDB0, 0xA6539930BF6BFF45, 0x84DB8346B786151C,
+    0xCFE87F7CEF46FF16, 0xE612641865679A63, 0x81F14FAE158C5F6E, 0x4FCB7E8F3F60C07E,
+    0xA26DA3999AEF7749, 0xE3BE5E330F38F09D, 0xCB090C8001AB551C, 0x5CADF5BFD3072CC5,
+    0xFDCB4FA002162A63, 0x73D9732FC7C8F7F6, 0x9E9F11C4014DDA7E, 0x2867E7FDDCDD9AFA,
+    0xC646D63501A1511D, 0xB281E1FD541501B8, 0xF7D88BC24209A565, 0x1F225A7CA91A4226,
+    0x9AE757596946075F, 0x3375788DE9B06958, 0xC1A12D2FC3978937, 0x0052D6B1641C83AE,
+    0xF209787BB47D6B84, 0xC0678C5DBD23A49A, 0x9745EB4D50CE6332, 0xF840B7BA963646E0,
+    0xBD176620A501FBFF, 0xB650E5A93BC3D898, 0xEC5D3FA8CE427AFF, 0xA3E51F138AB4CEBE,
+    0x93BA47C980E98CDF, 0xC66F336C36B10137, 0xB8A8D9BBE123F017, 0xB80B0047445D4184,
+    0xE6D3102AD96CEC1D, 0xA60DC059157491E5, 0x9043EA1AC7E41392, 0x87C89837AD68DB2F,
+    0xB454E4A179DD1877, 0x29BABE4598C311FB, 0xE16A1DC9D8545E94, 0xF4296DD6FEF3D67A,
+    0x8CE2529E2734BB1D, 0x1899E4A65F58660C, 0xB01AE745B101E9E4, 0x5EC05DCFF72E7F8F,
+    0xDC21A1171D42645D, 0x76707543F4FA1F73, 0x899504AE72497EBA, 0x6A06494A791C53A8,
+    0xABFA45DA0EDBDE69, 0x0487DB9D17636892, 0xD6F8D7509292D603, 0x45A9D2845D3C42B6,
+    0x865B86925B9BC5C2, 0x0B8A2392BA45A9B2, 0xA7F26836F282B732, 0x8E6CAC7768D7141E,
+    0xD1EF0244AF2364FF, 0x3207D795430CD926, 0x8335616AED761F1F, 0x7F44E6BD49E807B8,
+    0xA402B9C5A8D3A6E7, 0x5F16206C9C6209A6, 0xCD036837130890A1, 0x36DBA887C37A8C0F,
+    0x802221226BE55A64, 0xC2494954DA2C9789, 0xA02AA96B06DEB0FD, 0xF2DB9BAA10B7BD6C,
+    0xC83553C5C8965D3D, 0x6F92829494E5ACC7, 0xFA42A8B73ABBF48C, 0xCB772339BA1F17F9,
+    0x9C69A97284B578D7, 0xFF2A760414536EFB, 0xC38413CF25E2D70D, 0xFEF5138519684ABA,
+    0xF46518C2EF5B8CD1, 0x7EB258665FC25D69, 0x98BF2F79D5993802, 0xEF2F773FFBD97A61,
+    0xBEEEFB584AFF8603, 0xAAFB550FFACFD8FA, 0xEEAABA2E5DBF6784, 0x95BA2A53F983CF38,
+    0x952AB45CFA97A0B2, 0xDD945A747BF26183, 0xBA756174393D88DF, 0x94F971119AEEF9E4,
+    0xE912B9D1478CEB17, 0x7A37CD5601AAB85D, 0x91ABB422CCB812EE, 0xAC62E055C10AB33A,
+    0xB616A12B7FE617AA, 0x577B986B314D6009, 0xE39C49765FDF9D94, 0xED5A7E85FDA0B80B,
+    0x8E41ADE9FBEBC27D, 0x14588F13BE847307, 0xB1D219647AE6B31C, 0x596EB2D8AE258FC8,
+    0xDE469FBD99A05FE3, 0x6FCA5F8ED9AEF3BB, 0x8AEC23D680043BEE, 0x25DE7BB9480D5854,
+    0xADA72CCC20054AE9, 0xAF561AA79A10AE6A, 0xD910F7FF28069DA4, 0x1B2BA1518094DA04,
+    0x87AA9AFF79042286, 0x90FB44D2F05D0842, 0xA99541BF57452B28, 0x353A1607AC744A53,
+    0xD3FA922F2D1675F2, 0x42889B8997915CE8, 0x847C9B5D7C2E09B7, 0x69956135FEBADA11,
+    0xA59BC234DB398C25, 0x43FAB9837E699095, 0xCF02B2C21207EF2E, 0x94F967E45E03F4BB,
+    0x8161AFB94B44F57D, 0x1D1BE0EEBAC278F5, 0xA1BA1BA79E1632DC, 0x6462D92A69731732,
+    0xCA28A291859BBF93, 0x7D7B8F7503CFDCFE, 0xFCB2CB35E702AF78, 0x5CDA735244C3D43E,
+    0x9DEFBF01B061ADAB, 0x3A0888136AFA64A7, 0xC56BAEC21C7A1916, 0x088AAA1845B8FDD0,
+    0xF6C69A72A3989F5B, 0x8AAD549E57273D45, 0x9A3C2087A63F6399, 0x36AC54E2F678864B,
+    0xC0CB28A98FCF3C7F, 0x84576A1BB416A7DD, 0xF0FDF2D3F3C30B9F, 0x656D44A2A11C51D5,
+    0x969EB7C47859E743, 0x9F644AE5A4B1B325, 0xBC4665B596706114, 0x873D5D9F0DDE1FEE,
+    0xEB57FF22FC0C7959, 0xA90CB506D155A7EA, 0x9316FF75DD87CBD8, 0x09A7F12442D588F2,
+    0xB7DCBF5354E9BECE, 0x0C11ED6D538AEB2F, 0xE5D3EF282A242E81, 0x8F1668C8A86DA5FA,
+    0x8FA475791A569D10, 0xF96E017D694487BC, 0xB38D92D760EC4455, 0x37C981DCC395A9AC,
+    0xE070F78D3927556A, 0x85BBE253F47B1417, 0x8C469AB843B89562, 0x93956D7478CCEC8E,
+    0xAF58416654A6BABB, 0x387AC8D1970027B2, 0xDB2E51BFE9D0696A, 0x06997B05FCC0319E,
+    0x88FCF317F22241E2, 0x441FECE3BDF81F03, 0xAB3C2FDDEEAAD25A, 0xD527E81CAD7626C3,
+    0xD60B3BD56A5586F1, 0x8A71E223D8D3B074, 0x85C7056562757456, 0xF6872D5667844E49,
+    0xA738C6BEBB12D16C, 0xB428F8AC016561DB, 0xD106F86E69D785C7, 0xE13336D701BEBA52,
+    0x82A45B450226B39C, 0xECC0024661173473, 0xA34D721642B06084, 0x27F002D7F95D0190,
+    0xCC20CE9BD35C78A5, 0x31EC038DF7B441F4, 0xFF290242C83396CE, 0x7E67047175A15271,
+    0x9F79A169BD203E41, 0x0F0062C6E984D386, 0xC75809C42C684DD1, 0x52C07B78A3E60868,
+    0xF92E0C3537826145, 0xA7709A56CCDF8A82, 0x9BBCC7A142B17CCB, 0x88A66076400BB691,
+    0xC2ABF989935DDBFE, 0x6ACFF893D00EA435, 0xF356F7EBF83552FE, 0x0583F6B8C4124D43,
+    0x98165AF37B2153DE, 0xC3727A337A8B704A, 0xBE1BF1B059E9A8D6, 0x744F18C0592E4C5C,
+    0xEDA2EE1C7064130C, 0x1162DEF06F79DF73, 0x9485D4D1C63E8BE7, 0x8ADDCB5645AC2BA8,
+    0xB9A74A0637CE2EE1, 0x6D953E2BD7173692, 0xE8111C87C5C1BA99, 0xC8FA8DB6CCDD0437,
+    0x910AB1D4DB9914A0, 0x1D9C9892400A22A2, 0xB54D5E4A127F59C8, 0x2503BEB6D00CAB4B,
+    0xE2A0B5DC971F303A, 0x2E44AE64840FD61D, 0x8DA471A9DE737E24, 0x5CEAECFED289E5D2,
+    0xB10D8E1456105DAD, 0x7425A83E872C5F47, 0xDD50F1996B947518, 0xD12F124E28F77719,
+    0x8A5296FFE33CC92F, 0x82BD6B70D99AAA6F, 0xACE73CBFDC0BFB7B, 0x636CC64D1001550B,
+    0xD8210BEFD30EFA5A, 0x3C47F7E05401AA4E, 0x8714A775E3E95C78, 0x65ACFAEC34810A71,
+    0xA8D9D1535CE3B396, 0x7F1839A741A14D0D, 0xD31045A8341CA07C, 0x1EDE48111209A050,
+    0x83EA2B892091E44D, 0x934AED0AAB460432, 0xA4E4B66B68B65D60, 0xF81DA84D5617853F,
+    0xCE1DE40642E3F4B9, 0x36251260AB9D668E, 0x80D2AE83E9CE78F3, 0xC1D72B7C6B426019,
+    0xA1075A24E4421730, 0xB24CF65B8612F81F, 0xC94930AE1D529CFC, 0xDEE033F26797B627,
+    0xFB9B7CD9A4A7443C, 0x169840EF017DA3B1, 0x9D412E0806E88AA5, 0x8E1F289560EE864E,
+    0xC491798A08A2AD4E, 0xF1A6F2BAB92A27E2, 0xF5B5D7EC8ACB58A2, 0xAE10AF696774B1DB,
+    0x9991A6F3D6BF1765, 0xACCA6DA1E0A8EF29, 0xBFF610B0CC6EDD3F, 0x17FD090A58D32AF3,
+    0xEFF394DCFF8A948E, 0xDDFC4B4CEF07F5B0, 0x95F83D0A1FB69CD9, 0x4ABDAF101564F98E,
+    0xBB764C4CA7A4440F, 0x9D6D1AD41ABE37F1, 0xEA53DF5FD18D5513, 0x84C86189216DC5ED,
+    0x92746B9BE2F8552C, 0x32FD3CF5B4E49BB4, 0xB7118682DBB66A77, 0x3FBC8C33221DC2A1,
+    0xE4D5E82392A40515, 0x0FABAF3FEAA5334A, 0x8F05B1163BA6832D, 0x29CB4D87F2A7400E,
+    0xB2C71D5BCA9023F8, 0x743E20E9EF511012, 0xDF78E4B2BD342CF6, 0x914DA9246B255416,
+    0x8BAB8EEFB6409C1A, 0x1AD089B6C2F7548E, 0xAE9672ABA3D0C320, 0xA184AC2473B529B1,
+    0xDA3C0F568CC4F3E8, 0xC9E5D72D90A2741E, 0x8865899617FB1871, 0x7E2FA67C7A658892,
+    0xAA7EEBFB9DF9DE8D, 0xDDBB901B98FEEAB7, 0xD51EA6FA85785631, 0x552A74227F3EA565,
+    0x8533285C936B35DE, 0xD53A88958F87275F, 0xA67FF273B8460356, 0x8A892ABAF368F137,
+    0xD01FEF10A657842C, 0x2D2B7569B0432D85, 0x8213F56A67F6B29B, 0x9C3B29620E29FC73,
+    0xA298F2C501F45F42, 0x8349F3BA91B47B8F, 0xCB3F2F7642717713, 0x241C70A936219A73,
+    0xFE0EFB53D30DD4D7, 0xED238CD383AA0110, 0x9EC95D1463E8A506, 0xF4363804324A40AA,
+    0xC67BB4597CE2CE48, 0xB143C6053EDCD0D5, 0xF81AA16FDC1B81DA, 0xDD94B7868E94050A,
+    0x9B10A4E5E9913128, 0xCA7CF2B4191C8326, 0xC1D4CE1F63F57D72, 0xFD1C2F611F63A3F0,
+    0xF24A01A73CF2DCCF, 0xBC633B39673C8CEC, 0x976E41088617CA01, 0xD5BE0503E085D813,
+    0xBD49D14AA79DBC82, 0x4B2D8644D8A74E18, 0xEC9C459D51852BA2, 0xDDF8E7D60ED1219E,
+    0x93E1AB8252F33B45, 0xCABB90E5C942B503, 0xB8DA1662E7B00A17, 0x3D6A751F3B936243,
+    0xE7109BFBA19C0C9D, 0x0CC512670A783AD4, 0x906A617D450187E2, 0x27FB2B80668B24C5,
+    0xB484F9DC9641E9DA, 0xB1F9F660802DEDF6, 0xE1A63853BBD26451, 0x5E7873F8A0396973,
+    0x8D07E33455637EB2, 0xDB0B487B6423E1E8, 0xB049DC016ABC5E5F, 0x91CE1A9A3D2CDA62,
+    0xDC5C5301C56B75F7, 0x7641A140CC7810FB, 0x89B9B3E11B6329BA, 0xA9E904C87FCB0A9D,
+    0xAC2820D9623BF429, 0x546345FA9FBDCD44, 0xD732290FBACAF133, 0xA97C177947AD4095,
+    0x867F59A9D4BED6C0, 0x49ED8EABCCCC485D, 0xA81F301449EE8C70, 0x5C68F256BFFF5A74,
+    0xD226FC195C6A2F8C, 0x73832EEC6FFF3111, 0x83585D8FD9C25DB7, 0xC831FD53C5FF7EAB,
+    0xA42E74F3D032F525, 0xBA3E7CA8B77F5E55, 0xCD3A1230C43FB26F, 0x28CE1BD2E55F35EB,
+    0x80444B5E7AA7CF85, 0x7980D163CF5B81B3, 0xA0555E361951C366, 0xD7E105BCC332621F,
+    0xC86AB5C39FA63440, 0x8DD9472BF3FEFAA7, 0xFA856334878FC150, 0xB14F98F6F0FEB951,
+    0x9C935E00D4B9D8D2, 0x6ED1BF9A569F33D3, 0xC3B8358109E84F07, 0x0A862F80EC4700C8,
+    0xF4A642E14C6262C8, 0xCD27BB612758C0FA, 0x98E7E9CCCFBD7DBD, 0x8038D51CB897789C,
+    0xBF21E44003ACDD2C, 0xE0470A63E6BD56C3, 0xEEEA5D5004981478, 0x1858CCFCE06CAC74,
+    0x95527A5202DF0CCB, 0x0F37801E0C43EBC8, 0xBAA718E68396CFFD, 0xD30560258F54E6BA,
+    0xE950DF20247C83FD, 0x47C6B82EF32A2069, 0x91D28B7416CDD27E, 0x4CDC331D57FA5441,
+    0xB6472E511C81471D, 0xE0133FE4ADF8E952, 0xE3D8F9E563A198E5, 0x58180FDDD97723A6,
+    0x8E679C2F5E44FF8F, 0x570F09EAA7EA7648,
+};
+
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline void multiply(uint64_t a, uint64_t b, uint64_t &high, uint64_t &low) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    high = (uint64_t)(r >> 64);
+    low = (uint64_t)r;
+#else
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t lolo = aLo * bLo, hilo = aHi * bLo, lohi = aLo * bHi, hihi = aHi * bHi;
+    uint64_t cross = (lolo >> 32) + (uint32_t)hilo + lohi;
+    high = hihi + (hilo >> 32) + (cross >> 32);
+    low = (cross << 32) | (uint32_t)lolo;
+#endif
+}
+
+// Eisel-Lemire: mantissa * 10^exponent rounded to nearest, or false if the truncated
+// power of five is not precise enough or the result is subnormal or infinite.
+static bool eiselLemire(uint64_t mantissa, int exponent, double &result) {
+    int lz = __builtin_clzll(mantissa);
+    mantissa <<= lz;
+
+    const uint64_t *power = powersOf5 + 2 * (exponent + 342);
+    uint64_t upper, lower;
+    multiply(mantissa, power[0], upper, lower);
+    if ((upper & 0x1FF) == 0x1FF) {
+        uint64_t high, low;
+        multiply(mantissa, power[1], high, low);
+        lower += high;
+        if (high > lower)
+            ++upper;
+        // 5^q is exact within 128 bits only for -27 <= q <= 55
+        if (lower == UINT64_MAX && (exponent < -27 || exponent > 55))
+            return false;
+    }
 
-        double fraction = 1;
-        while (isdigit(*s)) {
-            fraction *= 0.1;
-            result += (*s++ - '0') * fraction;
+    int upperbit = (int)(upper >> 63);
+    int shift = upperbit + 9;
+    uint64_t bits = upper >> shift;
+    // exactly halfway between two doubles: round half to even
+    if (lower <= 1 && exponent >= -4 && exponent <= 23 && (bits & 3) == 1 && (bits << shift) == upper)
+        bits &= ~1ULL;
+    bits += bits & 1;
+    bits >>= 1;
+    lz -= upperbit;
+    if (bits >= (1ULL << 53)) {
+        bits = 1ULL << 52;
+        --lz;
+    }
+    bits &= ~(1ULL << 52);
+
+    int64_t binaryExponent = (((152170 + 65536) * (int64_t)exponent) >> 16) + 1023 + 63 - lz;
+    if (binaryExponent <= 0 || binaryExponent >= 2047)
+        return false;
+    uint64_t ival = bits | ((uint64_t)binaryExponent << 52);
+    memcpy(&result, &ival, sizeof(result));
+    return true;
+}
+
+// Eight digit loads never cross a page boundary, so they are safe right before the terminator.
+static inline bool canReadEight(const char *s) {
+    return !JSON_NO_OVERREAD && ((uintptr_t)s & 4095) <= 4096 - 8;
+}
+
+static inline bool isEightDigits(uint64_t v) {
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+static inline uint32_t parseEightDigits(uint64_t v) {
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    return (uint32_t)((((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+                       (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32);
+}
+
+// Accumulates up to 19 significant digits into mantissa, dropped integer digits go
+// to exponent and any dropped digit sets truncated. Fractions are usually long, so
+// they are tried eight digits at a time first.
+static inline char *parseDigits(char *s, uint64_t &mantissa, int &exponent, bool &truncated, bool fraction) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (fraction && mantissa < 100000000000ULL && canReadEight(s)) {
+        uint64_t v;
+        memcpy(&v, s, sizeof(v));
+        if (!isEightDigits(v))
+            break;
+        mantissa = mantissa * 100000000 + parseEightDigits(v);
+        exponent -= 8;
+        s += 8;
+    }
+#endif
+    for (; isdigit(*s); ++s) {
+        if (mantissa < 1000000000000000000ULL) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (fraction)
+                --exponent;
+        } else {
+            if (*s != '0')
+                truncated = true;
+            if (!fraction)
+                ++exponent;
         }
     }
+    return s;
+}
+
+// All cases the Clinger fast path in string2double can't handle.
+static double slowString2double(char *start, uint64_t mantissa, int exponent, bool truncated) {
+    double result;
+    if (exponent < -342)
+        return *start == '-' ? -0.0 : 0.0;
+    if (exponent > 308)
+        return *start == '-' ? -HUGE_VAL : HUGE_VAL;
+    if (!eiselLemire(mantissa, exponent, result))
+        return strtod(start, nullptr);
+#if JSON_EXACT_NUMBERS
+    if (truncated) {
+        // dropped digits only matter if mantissa + 1 rounds differently
+        double next;
+        if (!eiselLemire(mantissa + 1, exponent, next) || next != result)
+            return strtod(start, nullptr);
+    }
+#else
+    (void)truncated;
+#endif
+    return *start == '-' ? -result : result;
+}
+
+static inline double string2double(char *s, char **endptr) {
+    char *start = s;
+    bool negative = *s == '-';
+    if (negative)
+        ++s;
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool truncated = false;
+    s = parseDigits(s, mantissa, exponent, truncated, false);
+    if (*s == '.')
+        s = parseDigits(s + 1, mantissa, exponent, truncated, true);
 
     if (*s == 'e' || *s == 'E') {
         ++s;
 
-        double base = 10;
+        bool negativeExponent = false;
         if (*s == '+')
             ++s;
         else if (*s == '-') {
             ++s;
-            base = 0.1;
+            negativeExponent = true;
         }
 
-        unsigned int exponent = 0;
-        while (isdigit(*s))
-            exponent = (exponent * 10) + (*s++ - '0');
+        int e = 0;
+        for (; isdigit(*s); ++s)
+            if (e < 100000)
+                e = (e * 10) + (*s - '0');
+
+        exponent += negativeExponent ? -e : e;
+    }
+
+    *endptr = s;
+
+    double result = (double)mantissa;
+    if (mantissa == 0)
+        ;
+    else if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22 && !truncated)
+        // Clinger: both operands are exact, so a single IEEE operation rounds correctly
+        result = exponent < 0 ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+    else
+        return slowString2double(start, mantissa, exponent, truncated);
+    return negative ? -result : result;
+}
 
-        double power = 1;
-        for (; exponent; exponent >>= 1, base *= base)
-            if (exponent & 1)
-                power *= base;
+// Parses an integer which fits int64_t, fails without consuming anything on
+// fractions, exponents, -0 and overflow.
+static inline bool string2integer(char *s, char **endptr, int64_t &result) {
+    bool negative = *s == '-';
+    if (negative)
+        ++s;
 
-        result *= power;
+    uint64_t x = 0;
+    char *digits = s;
+    for (; isdigit(*s); ++s) {
+        if (s - digits == 19)
+            return false;
+        x = x * 10 + (*s - '0');
     }
+    if (*s == '.' || *s == 'e' || *s == 'E' || s == digits || (negative && x == 0))
+        return false;
+    if (x > (negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX))
+        return false;
 
     *endptr = s;
-    return ch == '-' ? -result : result;
+    result = negative ? (int64_t)(0 - x) : (int64_t)x;
+    return true;
+}
+
+// Integers within 46 bits are stored in the payload, the rest are boxed in allocator.
+static inline bool integerValue(int64_t x, JsonValue &value, JsonAllocator &allocator) {
+    if (x >= -(INT64_C(1) << 45) && x < (INT64_C(1) << 45)) {
+        value = JsonValue(JSON_INTEGER, (void *)(uintptr_t)((((uint64_t)x << 1) | 1) & JSON_VALUE_PAYLOAD_MASK));
+        return true;
+    }
+    int64_t *box = (int64_t *)allocator.allocate(sizeof(int64_t));
+    if (box == nullptr)
+        return false;
+    *box = x;
+    value = JsonValue(JSON_INTEGER, box);
+    return true;
+}
+
+static inline bool isscalar(char c) {
+    return isdigit(c) || c == '.' || c == 'E' || c == '+' || c == '-' || (c >= 'a' && c <= 'z');
+}
+
+// End of number or identifier. Streaming treats a token as complete only when the byte
+// after it is there too, so delimiter check sees the same byte jsonParse would.
+static inline char *scalarEnd(char *s, char *end) {
+    while (s < end && isscalar(*s))
+        ++s;
+    return s;
+}
+
+// Start of the run of number and identifier bytes right before end: a token starting
+// before it stops before end, one starting in it may run up to end.
+static inline char *scalarTail(char *begin, char *end) {
+    while (end > begin && isscalar(end[-1]))
+        --end;
+    return end;
+}
+
+static inline bool string2value(char *s, char **endptr, JsonValue &value, JsonAllocator &allocator, int flags) {
+    int64_t integer;
+    if ((flags & JSON_PARSE_INTEGERS) && string2integer(s, endptr, integer))
+        return integerValue(integer, value, allocator);
+    value = JsonValue(string2double(s, endptr));
+    return true;
+}
+
+// Number loops (and strtod) stop at the first non-digit, so a number which may run up
+// to the end of bounded source is parsed from a terminated copy in allocator.
+static char *copyNumber(char *s, char *end, JsonAllocator &allocator) {
+    char *copy = (char *)allocator.allocate(end - s + 1);
+    if (copy == nullptr)
+        return nullptr;
+    memcpy(copy, s, end - s);
+    copy[end - s] = 0;
+    return copy;
 }
 
 static inline JsonNode *insertAfter(JsonNode *tail, JsonNode *node) {
@@ -133,25 +1010,581 @@ static inline JsonValue listToValue(JsonTag tag, JsonNode *tail) {
     return JsonValue(tag, nullptr);
 }
 
-int jsonParse(char *s, char **endptr, JsonValue *value, JsonAllocator &allocator) {
-    JsonNode *tails[JSON_STACK_SIZE];
-    JsonTag tags[JSON_STACK_SIZE];
-    char *keys[JSON_STACK_SIZE];
-    JsonValue o;
-    int pos = -1;
-    bool separator = true;
-    JsonNode *node;
-    *endptr = s;
+JsonParseState::~JsonParseState() {
+    free(nodes);
+    if (tails != shallowTails)
+        free(tails);
+}
+
+bool JsonParseState::grow(int limit) {
+    int grown = depth * 2 < limit ? depth * 2 : limit;
+    // one block for all four, widest first
+    char *block = (char *)malloc(grown * (sizeof(JsonNode *) + sizeof(char *) + sizeof(size_t) + sizeof(JsonTag)));
+    if (block == nullptr)
+        return false;
+    JsonNode **newTails = (JsonNode **)block;
+    char **newKeys = (char **)(newTails + grown);
+    size_t *newStarts = (size_t *)(newKeys + grown);
+    JsonTag *newTags = (JsonTag *)(newStarts + grown);
+    memcpy(newTails, tails, depth * sizeof(JsonNode *));
+    memcpy(newKeys, keys, depth * sizeof(char *));
+    memcpy(newStarts, starts, depth * sizeof(size_t));
+    memcpy(newTags, tags, depth * sizeof(JsonTag));
+    if (tails != shallowTails)
+        free(tails);
+    tails = newTails;
+    keys = newKeys;
+    starts = newStarts;
+    tags = newTags;
+    depth = grown;
+    return true;
+}
+
+// JSON_PARSE_CONTIGUOUS: next node of innermost open array or object
+static inline JsonNode *pushNode(JsonParseState &state) {
+    if (state.size == state.capacity) {
+        size_t capacity = state.capacity ? state.capacity * 2 : 256;
+        JsonNode *nodes = (JsonNode *)realloc(state.nodes, capacity * sizeof(JsonNode));
+        if (nodes == nullptr)
+            return nullptr;
+        state.nodes = nodes;
+        state.capacity = capacity;
+    }
+    return &state.nodes[state.size++];
+}
+
+static inline size_t nodeSize(JsonTag tag) {
+    return tag == JSON_ARRAY ? JSON_ARRAY_NODE_SIZE : sizeof(JsonNode);
+}
+
+static inline size_t blockHeader(JsonTag tag) {
+    return tag == JSON_OBJECT ? 2 * sizeof(void *) : sizeof(size_t);
+}
+
+// Block of count nodes right after their count, it lives in value's payload with lowest
+// bit set. Objects have one more word before the count for the jsonFind index.
+static inline char *placeBlock(char *memory, JsonTag tag, size_t count, JsonValue &value) {
+    if (tag == JSON_OBJECT)
+        *(void **)memory = nullptr;
+    char *block = memory + blockHeader(tag);
+    ((size_t *)block)[-1] = count;
+    value = JsonValue(tag, block + 1);
+    return block;
+}
+
+static char *allocateBlock(JsonTag tag, size_t count, JsonValue &value, JsonAllocator &allocator) {
+    char *memory = (char *)allocator.allocate(blockHeader(tag) + count * nodeSize(tag));
+    if (memory == nullptr)
+        return nullptr;
+    return placeBlock(memory, tag, count, value);
+}
+
+// Fills block from it on, next pointers run through the block; the last one is left to caller
+static inline char *copyNodes(JsonTag tag, char *it, const JsonNode *nodes, size_t count) {
+    for (size_t i = 0; i < count; ++i, it += nodeSize(tag)) {
+        JsonNode *node = (JsonNode *)it;
+        node->value = nodes[i].value;
+        node->next = (JsonNode *)(it + nodeSize(tag));
+        if (tag == JSON_OBJECT)
+            node->key = nodes[i].key;
+    }
+    return it;
+}
+
+// Pops innermost array or object off the node stack into its block
+static inline bool popNodes(JsonTag tag, JsonParseState &state, int pos, JsonValue &value, JsonAllocator &allocator) {
+    size_t count = state.size - state.starts[pos];
+    state.size = state.starts[pos];
+    if (!count) {
+        value = JsonValue(tag, nullptr);
+        return true;
+    }
+    char *it = allocateBlock(tag, count, value, allocator);
+    if (it == nullptr)
+        return false;
+    it = copyNodes(tag, it, state.nodes + state.size, count);
+    ((JsonNode *)(it - nodeSize(tag)))->next = nullptr;
+    return true;
+}
+
+namespace {
+// Walks the source byte by byte, skipping whitespace before every token.
+struct ScanCursor {
+    bool next(char *&s) {
+        while (isspace(*s))
+            ++s;
+        return *s != 0;
+    }
+};
+
+// Padded source ends at the terminator written after end, NUL before it is a byte
+// like any other, which parse rejects there.
+struct PaddedScanCursor {
+    char *end;
+
+    bool next(char *&s) {
+        while (isspace(*s))
+            ++s;
+        return *s != 0 || s < end;
+    }
+};
+
+// Trailing whitespace is cut off first, so a non-space byte always stops the skip before end.
+class BoundedScanCursor {
+    char *end;
+
+public:
+    BoundedScanCursor(char *begin, char *end)
+        : end(end) {
+        while (this->end > begin && isspace(this->end[-1]))
+            --this->end;
+    }
+    bool next(char *&s) {
+        if (s >= end)
+            return false;
+        while (isspace(*s))
+            ++s;
+        return true;
+    }
+};
+
+// Bitmasks of interesting bytes in a 64 byte block, bit i for byte i.
+struct Block {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t space;
+    // structural characters and NUL, which is indexed so bounded parse rejects it in place
+    uint64_t op;
+    // '[' or '{', ']' or '}'
+    uint64_t open;
+    uint64_t close;
+};
+} // namespace
+
+#if defined(__AVX2__)
+static inline void classify(const char *p, Block &b) {
+    b.quote = b.backslash = b.space = b.op = b.open = b.close = 0;
+    for (int i = 0; i < 64; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+        __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                                        _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8('\r' - '\t')), t));
+        // '[' and ']' are '{' and '}' without bit 0x20
+        __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+        __m256i open = _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{'));
+        __m256i close = _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'));
+        __m256i op = _mm256_or_si256(_mm256_or_si256(open, close), _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(',')),
+                                                              _mm256_cmpeq_epi8(x, _mm256_set1_epi8(':'))));
+        op = _mm256_or_si256(op, _mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+        b.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'))) << i;
+        b.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))) << i;
+        b.space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << i;
+        b.op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << i;
+        b.open |= (uint64_t)(uint32_t)_mm256_movemask_epi8(open) << i;
+        b.close |= (uint64_t)(uint32_t)_mm256_movemask_epi8(close) << i;
+    }
+}
+#elif defined(__SSE2__)
+static inline void classify(const char *p, Block &b) {
+    b.quote = b.backslash = b.space = b.op = b.open = b.close = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i t = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+        __m128i space = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                                     _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t));
+        // '[' and ']' are '{' and '}' without bit 0x20
+        __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+        __m128i open = _mm_cmpeq_epi8(lower, _mm_set1_epi8('{'));
+        __m128i close = _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'));
+        __m128i op = _mm_or_si128(_mm_or_si128(open, close), _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(',')),
+                                                        _mm_cmpeq_epi8(x, _mm_set1_epi8(':'))));
+        op = _mm_or_si128(op, _mm_cmpeq_epi8(x, _mm_setzero_si128()));
+        b.quote |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"'))) << i;
+        b.backslash |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))) << i;
+        b.space |= (uint64_t)_mm_movemask_epi8(space) << i;
+        b.op |= (uint64_t)_mm_movemask_epi8(op) << i;
+        b.open |= (uint64_t)_mm_movemask_epi8(open) << i;
+        b.close |= (uint64_t)_mm_movemask_epi8(close) << i;
+    }
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+static inline uint64_t neonMask(const uint8x16_t m[4]) {
+    const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(m[0], bits), vandq_u8(m[1], bits));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(m[2], bits), vandq_u8(m[3], bits));
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+static inline void classify(const char *p, Block &b) {
+    uint8x16_t quote[4], backslash[4], space[4], op[4], open[4], close[4];
+    for (int i = 0; i < 4; ++i) {
+        uint8x16_t x = vld1q_u8((const uint8_t *)(p + i * 16));
+        quote[i] = vceqq_u8(x, vdupq_n_u8('"'));
+        backslash[i] = vceqq_u8(x, vdupq_n_u8('\\'));
+        space[i] = vorrq_u8(vceqq_u8(x, vdupq_n_u8(' ')), vcleq_u8(vsubq_u8(x, vdupq_n_u8('\t')), vdupq_n_u8('\r' - '\t')));
+        // '[' and ']' are '{' and '}' without bit 0x20
+        uint8x16_t lower = vorrq_u8(x, vdupq_n_u8(0x20));
+        open[i] = vceqq_u8(lower, vdupq_n_u8('{'));
+        close[i] = vceqq_u8(lower, vdupq_n_u8('}'));
+        op[i] = vorrq_u8(vorrq_u8(open[i], close[i]), vorrq_u8(vceqq_u8(x, vdupq_n_u8(',')), vceqq_u8(x, vdupq_n_u8(':'))));
+        op[i] = vorrq_u8(op[i], vceqzq_u8(x));
+    }
+    b.quote = neonMask(quote);
+    b.backslash = neonMask(backslash);
+    b.space = neonMask(space);
+    b.op = neonMask(op);
+    b.open = neonMask(open);
+    b.close = neonMask(close);
+}
+#else
+static inline void classify(const char *p, Block &b) {
+    b.quote = b.backslash = b.space = b.op = b.open = b.close = 0;
+    for (int i = 0; i < 64; ++i) {
+        char c = p[i];
+        b.quote |= (uint64_t)(c == '"') << i;
+        b.backslash |= (uint64_t)(c == '\\') << i;
+        b.space |= (uint64_t)isspace(c) << i;
+        b.op |= (uint64_t)(c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':' || !c) << i;
+        b.open |= (uint64_t)(c == '{' || c == '[') << i;
+        b.close |= (uint64_t)(c == '}' || c == ']') << i;
+    }
+}
+#endif
+
+static inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Bytes preceded by an odd run of backslashes, carrying a run across blocks.
+static inline uint64_t findEscaped(uint64_t backslash, uint64_t &carry) {
+    const uint64_t odd = 0xAAAAAAAAAAAAAAAAULL;
+    if (!backslash) {
+        uint64_t escaped = carry;
+        carry = 0;
+        return escaped;
+    }
+    uint64_t potential = backslash & ~carry;
+    uint64_t code = (((potential << 1) | odd) - potential) ^ odd;
+    uint64_t escaped = code ^ (backslash | carry);
+    carry = (code & backslash) >> 63;
+    return escaped;
+}
+
+// Indexed mode: stage one finds every structural character, NUL, opening quote and first
+// byte of a number or identifier outside of strings, stage two (the parser) jumps
+// straight from token to token. Stage one runs over a window of the source at a time,
+// so the index stays small and hot in cache and no memory is allocated for it.
+class IndexCursor {
+    enum { INDEX_SIZE = 512 };
+
+    char *block;
+    char *end;
+    uint64_t escapedCarry;
+    uint64_t inStringCarry;
+    uint64_t scalarCarry;
+    char **it;
+    char **last;
+    char *index[INDEX_SIZE];
+
+    void refill() {
+        it = last = index;
+        for (; block < end && last + 64 <= index + INDEX_SIZE; block += 64) {
+            Block b;
+            if (end - block >= 64) {
+                classify(block, b);
+            } else {
+                char tail[64];
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, block, end - block);
+                classify(tail, b);
+            }
+
+            uint64_t quote = b.quote & ~findEscaped(b.backslash, escapedCarry);
+            uint64_t inString = prefixXor(quote) ^ inStringCarry;
+            inStringCarry = (uint64_t)((int64_t)inString >> 63);
+            uint64_t scalar = ~(b.op | b.space | quote);
+            uint64_t starts = scalar & ~((scalar << 1) | scalarCarry);
+            scalarCarry = scalar >> 63;
+
+            for (uint64_t bits = ((b.op | starts) & ~inString) | (quote & inString); bits; bits &= bits - 1)
+                *last++ = block + __builtin_ctzll(bits);
+        }
+    }
+
+public:
+    IndexCursor(char *s, size_t size)
+        : block(s), end(s + size), escapedCarry(0), inStringCarry(0), scalarCarry(0), it(index), last(index) {
+    }
+    bool next(char *&s) {
+        for (;;) {
+            while (it != last && *it < s)
+                ++it;
+            if (it != last) {
+                s = *it++;
+                return true;
+            }
+            if (block >= end)
+                return false;
+            // The parser may have decoded a string past the window in place already;
+            // it stops right after a complete token, so restart stage one from there.
+            if (block < s) {
+                block = s;
+                escapedCarry = inStringCarry = scalarCarry = 0;
+            }
+            refill();
+        }
+    }
+};
+
+// Structure-only scan for skipping and splitting: brackets and other structural characters
+// outside of strings, 64 bytes at a time with the same masks as indexed mode.
+struct StructureScanner {
+    char *block;
+    char *ahead;
+    char *end;
+    uint64_t escapedCarry;
+    uint64_t inStringCarry;
+    uint64_t op;
+    uint64_t open;
+    uint64_t close;
+
+    StructureScanner(char *s, char *end)
+        : block(s), ahead(s), end(end), escapedCarry(0), inStringCarry(0) {
+    }
+    // Classifies the next block, false at end.
+    bool next() {
+        if ((block = ahead) >= end)
+            return false;
+        ahead += 64;
+        Block b;
+        if (end - block >= 64) {
+            classify(block, b);
+        } else {
+            char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, end - block);
+            classify(tail, b);
+        }
+        uint64_t quote = b.quote & ~findEscaped(b.backslash, escapedCarry);
+        uint64_t inString = prefixXor(quote) ^ inStringCarry;
+        inStringCarry = (uint64_t)((int64_t)inString >> 63);
+        op = b.op & ~inString;
+        open = b.open & ~inString;
+        close = b.close & ~inString;
+        return true;
+    }
+};
+
+// Builds the tree of JsonNode, handler of parseTokens() for jsonParse and friends
+struct DomBuilder {
+    JsonValue *result;
+    JsonAllocator &allocator;
+    JsonParseState &state;
+    int flags;
+
+    void open(JsonTag, int pos) {
+        state.tails[pos] = nullptr;
+        if (flags & JSON_PARSE_CONTIGUOUS)
+            state.starts[pos] = state.size;
+    }
+    bool close(JsonTag tag, int pos, JsonValue &o) {
+        if (!(flags & JSON_PARSE_CONTIGUOUS)) {
+            o = listToValue(tag, state.tails[pos]);
+            return true;
+        }
+        return popNodes(tag, state, pos, o, allocator);
+    }
+    // end is at terminator of the key
+    char *key(char *key, char *end) {
+        if (flags & JSON_PARSE_INTERN_KEYS)
+            return allocator.intern(key, end - key);
+        return key;
+    }
+    bool value(JsonValue o, char *, int pos) {
+        if (pos == -1) {
+            *result = o;
+            return true;
+        }
+        JsonNode *node;
+        if (flags & JSON_PARSE_CONTIGUOUS) {
+            if ((node = pushNode(state)) == nullptr)
+                return false;
+            node->value = o;
+            node->key = state.keys[pos];
+            return true;
+        }
+        if (state.tags[pos] == JSON_OBJECT) {
+            if ((node = (JsonNode *) allocator.allocate(sizeof(JsonNode))) == nullptr)
+                return false;
+            state.tails[pos] = insertAfter(state.tails[pos], node);
+            node->key = state.keys[pos];
+        } else {
+            if ((node = (JsonNode *) allocator.allocate(JSON_ARRAY_NODE_SIZE)) == nullptr)
+                return false;
+            state.tails[pos] = insertAfter(state.tails[pos], node);
+        }
+        node->value = o;
+        return true;
+    }
+    bool full() const {
+        return false;
+    }
+};
 
-    while (*s) {
-        while (isspace(*s)) {
+// Handlers which ignore strings let them be checked only, so source is never written
+template <typename Handler>
+struct ChecksOnly {
+    static const bool value = false;
+};
+
+// String from after its opening quote, checked as decoding loop of parseTokens checks it:
+// s ends after closing quote, or at the first bad byte
+template <bool Bounded>
+static inline bool checkString(char *&s, char *end) {
+    for (;;) {
+        s = scanString<Bounded>(s, end);
+        if (Bounded ? s >= end : !*s)
+            return !Bounded;
+        if (*s == '"') {
             ++s;
-            if (!*s) break;
+            return true;
+        }
+        if (*s != '\\')
+            return false;
+        switch (peek<Bounded>(++s, end)) {
+        case '\\':
+        case '"':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            break;
+        case 'u':
+            for (int i = 0; i < 4; ++i)
+                if (!isxdigit(peek<Bounded>(++s, end)))
+                    return false;
+            break;
+        default:
+            return false;
         }
+        ++s;
+    }
+}
+
+// Counts of one parseTokens() call, added to stats of allocator when it returns
+template <bool Enabled>
+struct TokenCounts {
+    TokenCounts(JsonAllocator &, char *, char **) {
+    }
+    void value(JsonTag) {
+    }
+    void key() {
+    }
+    void escape() {
+    }
+    void depth(int) {
+    }
+};
+
+template <>
+struct TokenCounts<true> {
+    JsonStats *stats;
+    char *begin;
+    char **endptr;
+    size_t values[JSON_NULL + 1];
+    size_t keys;
+    size_t escapes;
+    int maxDepth;
+
+    TokenCounts(JsonAllocator &allocator, char *begin, char **endptr)
+        : stats(allocator.getStats()), begin(begin), endptr(endptr), values(), keys(0), escapes(0), maxDepth(0) {
+    }
+    ~TokenCounts() {
+        if (stats == nullptr)
+            return;
+        if (*endptr > begin)
+            stats->bytes += *endptr - begin;
+        for (int i = 0; i <= JSON_NULL; ++i)
+            stats->values[i] += values[i];
+        stats->keys += keys;
+        stats->escapes += escapes;
+        if (stats->maxDepth < maxDepth)
+            stats->maxDepth = maxDepth;
+    }
+    void value(JsonTag tag) {
+        values[tag]++;
+    }
+    void key() {
+        keys++;
+    }
+    void escape() {
+        escapes++;
+    }
+    void depth(int pos) {
+        if (maxDepth <= pos)
+            maxDepth = pos + 1;
+    }
+};
+
+// Validates and decodes tokens, handler gets values as they complete and brackets:
+// open() and close() for arrays and objects, close() making the container value which
+// then goes to value() like a scalar, with end of the string for strings only; key()
+// returns key to keep, nullptr if out of memory.
+// Handler which is full() stops parse with JSON_INCOMPLETE right before the next token.
+// Streaming parse returns JSON_INCOMPLETE instead of failing when bounded input ends
+// within a token or before the document does; state keeps everything to resume with.
+template <bool Bounded, bool Streaming, typename Cursor, typename Handler>
+static int parseTokens(char *s, char *end, char **endptr, Handler &handler, JsonAllocator &allocator, Cursor &cursor, int flags, JsonParseState &state) {
+    JsonTag *tags = state.tags;
+    char **keys = state.keys;
+    int pos = state.pos;
+    bool separator = state.separator;
+    int limit = flags >> 16 ? flags >> 16 : JSON_MAX_DEPTH;
+    int room = state.depth < limit ? state.depth : limit;
+    JsonValue o;
+    // end of the last string, where its terminator is
+    char *it = nullptr;
+    char *tail = Bounded ? scalarTail(s, end) : nullptr;
+    TokenCounts<JSON_STATS> counts(allocator, s, endptr);
+    // locals are faster in the loop, state is written back only to resume with
+    auto incomplete = [&](char *rest) {
+        state.pos = pos;
+        state.separator = separator;
+        *endptr = rest;
+        return JSON_INCOMPLETE;
+    };
+    // nesting is past the levels state has room for
+    auto deeper = [&]() {
+        if (pos >= limit)
+            return JSON_STACK_OVERFLOW;
+        if (!state.grow(limit))
+            return JSON_ALLOCATION_FAILURE;
+        tags = state.tags;
+        keys = state.keys;
+        room = state.depth;
+        return JSON_OK;
+    };
+    *endptr = s;
+
+    while (cursor.next(s)) {
+        if (handler.full())
+            return incomplete(s);
         *endptr = s++;
+        if (Bounded && Streaming && *endptr >= tail)
+            return incomplete(*endptr);
         switch (**endptr) {
         case '-':
-            if (!isdigit(*s) && *s != '.') {
+            if (!isdigit(peek<Bounded>(s, end)) && peek<Bounded>(s, end) != '.') {
                 *endptr = s;
                 return JSON_BAD_NUMBER;
             }
@@ -165,92 +1598,139 @@ int jsonParse(char *s, char **endptr, JsonValue *value, JsonAllocator &allocator
         case '7':
         case '8':
         case '9':
-            o = JsonValue(string2double(*endptr, &s));
-            if (!isdelim(*s)) {
+            it = *endptr;
+            if (Bounded && it >= tail && (it = copyNumber(it, end, allocator)) == nullptr)
+                return JSON_ALLOCATION_FAILURE;
+            if (!string2value(it, &s, o, allocator, flags))
+                return JSON_ALLOCATION_FAILURE;
+            if (Bounded && it != *endptr)
+                s = *endptr + (s - it);
+            if (!isdelim(peek<Bounded>(s, end))) {
                 *endptr = s;
                 return JSON_BAD_NUMBER;
             }
             break;
         case '"':
-            o = JsonValue(JSON_STRING, s);
-            for (char *it = s; *s; ++it, ++s) {
-                int c = *it = *s;
-                if (c == '\\') {
-                    c = *++s;
-                    switch (c) {
-                    case '\\':
-                    case '"':
-                    case '/':
-                        *it = c;
-                        break;
-                    case 'b':
-                        *it = '\b';
-                        break;
-                    case 'f':
-                        *it = '\f';
-                        break;
-                    case 'n':
-                        *it = '\n';
-                        break;
-                    case 'r':
-                        *it = '\r';
-                        break;
-                    case 't':
-                        *it = '\t';
+            if (ChecksOnly<Handler>::value) {
+                if (!checkString<Bounded>(s, end)) {
+                    *endptr = s;
+                    return JSON_BAD_STRING;
+                }
+                o = JsonValue(JSON_STRING, *endptr + 1);
+                it = s;
+            } else {
+                s = scanString<Bounded>(s, end);
+                // checked before decoding in place, so unfinished string is copied intact
+                if (Bounded && Streaming && stringEnd<true>(s, end) >= end - 1)
+                    return incomplete(*endptr);
+                if (flags & (JSON_PARSE_NONDESTRUCTIVE | JSON_PARSE_STRING_LENGTHS)) {
+                    // copy to allocator, decoded string is never longer than source
+                    size_t prefix = flags & JSON_PARSE_STRING_LENGTHS ? sizeof(size_t) : 0;
+                    if ((it = (char *)allocator.allocate(prefix + stringEnd<Bounded>(s, end) - *endptr)) == nullptr)
+                        return JSON_ALLOCATION_FAILURE;
+                    it += prefix;
+                    o = JsonValue(JSON_STRING, it);
+                    memcpy(it, *endptr + 1, s - *endptr - 1);
+                    it += s - *endptr - 1;
+                } else {
+                    o = JsonValue(JSON_STRING, *endptr + 1);
+                    it = s;
+                }
+                for (;; ++it, ++s) {
+                    if (Bounded ? s >= end : !*s) {
+                        // NUL terminated source ends string right there, bounded one has no room
+                        // for it, and padded one is bounded source with the terminator at end
+                        if (Bounded || (flags & JSON_PARSE_PADDED)) {
+                            *endptr = s;
+                            return JSON_BAD_STRING;
+                        }
+                        *it = 0;
                         break;
-                    case 'u':
-                        c = 0;
-                        for (int i = 0; i < 4; ++i) {
-                            if (isxdigit(*++s)) {
-                                c = c * 16 + char2int(*s);
+                    }
+                    int c = *it = *s;
+                    if (c == '\\') {
+                        counts.escape();
+                        c = peek<Bounded>(++s, end);
+                        switch (c) {
+                        case '\\':
+                        case '"':
+                        case '/':
+                            *it = c;
+                            break;
+                        case 'b':
+                            *it = '\b';
+                            break;
+                        case 'f':
+                            *it = '\f';
+                            break;
+                        case 'n':
+                            *it = '\n';
+                            break;
+                        case 'r':
+                            *it = '\r';
+                            break;
+                        case 't':
+                            *it = '\t';
+                            break;
+                        case 'u':
+                            c = 0;
+                            for (int i = 0; i < 4; ++i) {
+                                if (isxdigit(peek<Bounded>(++s, end))) {
+                                    c = c * 16 + char2int(*s);
+                                } else {
+                                    *endptr = s;
+                                    return JSON_BAD_STRING;
+                                }
+                            }
+                            if (c < 0x80) {
+                                *it = c;
+                            } else if (c < 0x800) {
+                                *it++ = 0xC0 | (c >> 6);
+                                *it = 0x80 | (c & 0x3F);
                             } else {
-                                *endptr = s;
-                                return JSON_BAD_STRING;
+                                *it++ = 0xE0 | (c >> 12);
+                                *it++ = 0x80 | ((c >> 6) & 0x3F);
+                                *it = 0x80 | (c & 0x3F);
                             }
+                            break;
+                        default:
+                            *endptr = s;
+                            return JSON_BAD_STRING;
                         }
-                        if (c < 0x80) {
-                            *it = c;
-                        } else if (c < 0x800) {
-                            *it++ = 0xC0 | (c >> 6);
-                            *it = 0x80 | (c & 0x3F);
-                        } else {
-                            *it++ = 0xE0 | (c >> 12);
-                            *it++ = 0x80 | ((c >> 6) & 0x3F);
-                            *it = 0x80 | (c & 0x3F);
-                        }
-                        break;
-                    default:
+                    } else if ((unsigned int)c < ' ' || c == '\x7F') {
                         *endptr = s;
                         return JSON_BAD_STRING;
+                    } else if (c == '"') {
+                        *it = 0;
+                        ++s;
+                        break;
                     }
-                } else if ((unsigned int)c < ' ' || c == '\x7F') {
-                    *endptr = s;
-                    return JSON_BAD_STRING;
-                } else if (c == '"') {
-                    *it = 0;
-                    ++s;
-                    break;
                 }
+                if (flags & JSON_PARSE_STRING_LENGTHS)
+                    ((size_t *)o.toString())[-1] = it - o.toString();
             }
-            if (!isdelim(*s)) {
+            if (!isdelim(peek<Bounded>(s, end))) {
                 *endptr = s;
                 return JSON_BAD_STRING;
             }
             break;
         case 't':
-            if (!(s[0] == 'r' && s[1] == 'u' && s[2] == 'e' && isdelim(s[3])))
+            if (!(peek<Bounded>(s, end) == 'r' && peek<Bounded>(s + 1, end) == 'u' && peek<Bounded>(s + 2, end) == 'e' &&
+                  isdelim(peek<Bounded>(s + 3, end))))
                 return JSON_BAD_IDENTIFIER;
             o = JsonValue(JSON_TRUE);
             s += 3;
             break;
         case 'f':
-            if (!(s[0] == 'a' && s[1] == 'l' && s[2] == 's' && s[3] == 'e' && isdelim(s[4])))
+            if (!(peek<Bounded>(s, end) == 'a' && peek<Bounded>(s + 1, end) == 'l' && peek<Bounded>(s + 2, end) == 's' &&
+                  peek<Bounded>(s + 3, end) == 'e' && isdelim(peek<Bounded>(s + 4, end))))
                 return JSON_BAD_IDENTIFIER;
             o = JsonValue(JSON_FALSE);
             s += 4;
             break;
         case 'n':
-            if (!(s[0] == 'u' && s[1] == 'l' && s[2] == 'l' && isdelim(s[3])))
+            if (!(peek<Bounded>(s, end) == 'u' && peek<Bounded>(s + 1, end) == 'l' && peek<Bounded>(s + 2, end) == 'l' &&
+                  isdelim(peek<Bounded>(s + 3, end))))
                 return JSON_BAD_IDENTIFIER;
             o = JsonValue(JSON_NULL);
             s += 3;
@@ -260,7 +1740,8 @@ int jsonParse(char *s, char **endptr, JsonValue *value, JsonAllocator &allocator
                 return JSON_STACK_UNDERFLOW;
             if (tags[pos] != JSON_ARRAY)
                 return JSON_MISMATCH_BRACKET;
-            o = listToValue(JSON_ARRAY, tails[pos--]);
+            if (!handler.close(JSON_ARRAY, pos--, o))
+                return JSON_ALLOCATION_FAILURE;
             break;
         case '}':
             if (pos == -1)
@@ -269,22 +1750,31 @@ int jsonParse(char *s, char **endptr, JsonValue *value, JsonAllocator &allocator
                 return JSON_MISMATCH_BRACKET;
             if (keys[pos] != nullptr)
                 return JSON_UNEXPECTED_CHARACTER;
-            o = listToValue(JSON_OBJECT, tails[pos--]);
+            if (!handler.close(JSON_OBJECT, pos--, o))
+                return JSON_ALLOCATION_FAILURE;
             break;
         case '[':
-            if (++pos == JSON_STACK_SIZE)
-                return JSON_STACK_OVERFLOW;
-            tails[pos] = nullptr;
+            if (++pos == room) {
+                int status = deeper();
+                if (status != JSON_OK)
+                    return status;
+            }
             tags[pos] = JSON_ARRAY;
             keys[pos] = nullptr;
+            counts.depth(pos);
+            handler.open(JSON_ARRAY, pos);
             separator = true;
             continue;
         case '{':
-            if (++pos == JSON_STACK_SIZE)
-                return JSON_STACK_OVERFLOW;
-            tails[pos] = nullptr;
+            if (++pos == room) {
+                int status = deeper();
+                if (status != JSON_OK)
+                    return status;
+            }
             tags[pos] = JSON_OBJECT;
             keys[pos] = nullptr;
+            counts.depth(pos);
+            handler.open(JSON_OBJECT, pos);
             separator = true;
             continue;
         case ':':
@@ -297,38 +1787,2082 @@ int jsonParse(char *s, char **endptr, JsonValue *value, JsonAllocator &allocator
                 return JSON_UNEXPECTED_CHARACTER;
             separator = true;
             continue;
-        case '\0':
-            continue;
         default:
             return JSON_UNEXPECTED_CHARACTER;
         }
 
         separator = false;
 
+        if (pos != -1 && tags[pos] == JSON_OBJECT && !keys[pos]) {
+            if (o.getTag() != JSON_STRING)
+                return JSON_UNQUOTED_KEY;
+            // it is still at terminator of the key
+            if ((keys[pos] = handler.key(o.toString(), it)) == nullptr)
+                return JSON_ALLOCATION_FAILURE;
+            counts.key();
+            continue;
+        }
+        if (!handler.value(o, it, pos))
+            return JSON_ALLOCATION_FAILURE;
+        counts.value(o.getTag());
         if (pos == -1) {
             *endptr = s;
-            *value = o;
             return JSON_OK;
         }
+        keys[pos] = nullptr;
+    }
+    // cursor is done with the rest of bounded input, even if it didn't move s there
+    if (Streaming)
+        return incomplete(Bounded ? end : s);
+    return JSON_BREAKING_BAD;
+}
+
+template <bool Bounded, bool Streaming, typename Cursor>
+static int parse(char *s, char *end, char **endptr, JsonValue *value, JsonAllocator &allocator, Cursor &cursor, int flags, JsonParseState &state) {
+    DomBuilder builder{value, allocator, state, flags};
+    return parseTokens<Bounded, Streaming>(s, end, endptr, builder, allocator, cursor, flags, state);
+}
+
+// Status of parse(), counted in stats of allocator and timed for their hook
+template <typename Parse>
+static int measure(JsonAllocator &allocator, Parse parse) {
+    JsonStats *stats = allocator.getStats();
+    if (!JSON_STATS || stats == nullptr)
+        return parse();
+    auto start = std::chrono::steady_clock::now();
+    int status = parse();
+    stats->parses++;
+    if (status != JSON_OK)
+        stats->failures++;
+    if (stats->hook)
+        stats->hook(*stats, status, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+                    stats->context);
+    return status;
+}
+
+int jsonParse(char *s, char **endptr, JsonValue *value, JsonAllocator &allocator, int flags) {
+    return measure(allocator, [&]() {
+        JsonParseState state;
+        if (flags & JSON_PARSE_INDEXED) {
+            IndexCursor cursor(s, strlen(s));
+            return parse<false, false>(s, nullptr, endptr, value, allocator, cursor, flags, state);
+        }
+        ScanCursor cursor;
+        return parse<false, false>(s, nullptr, endptr, value, allocator, cursor, flags, state);
+    });
+}
 
-        if (tags[pos] == JSON_OBJECT) {
-            if (!keys[pos]) {
-                if (o.getTag() != JSON_STRING)
-                    return JSON_UNQUOTED_KEY;
-                keys[pos] = o.toString();
-                continue;
+// Parse of [begin, end) with cursor flags ask for
+template <typename Handler>
+static int parseBounded(char *begin, char *end, char **endptr, Handler &handler, JsonAllocator &allocator, int flags, JsonParseState &state) {
+    if (flags & JSON_PARSE_PADDED) {
+        // terminator goes to slack, checked first so zero padded read-only memory is never written
+        if (*end)
+            *end = 0;
+        if (flags & JSON_PARSE_INDEXED) {
+            IndexCursor cursor(begin, end - begin);
+            return parseTokens<false, false>(begin, end, endptr, handler, allocator, cursor, flags, state);
+        }
+        PaddedScanCursor cursor = {end};
+        return parseTokens<false, false>(begin, end, endptr, handler, allocator, cursor, flags, state);
+    }
+    if (flags & JSON_PARSE_INDEXED) {
+        IndexCursor cursor(begin, end - begin);
+        return parseTokens<true, false>(begin, end, endptr, handler, allocator, cursor, flags, state);
+    }
+    BoundedScanCursor cursor(begin, end);
+    return parseTokens<true, false>(begin, end, endptr, handler, allocator, cursor, flags, state);
+}
+
+int jsonParse(char *begin, char *end, char **endptr, JsonValue *value, JsonAllocator &allocator, int flags) {
+    return measure(allocator, [&]() {
+        JsonParseState state;
+        DomBuilder builder{value, allocator, state, flags};
+        return parseBounded(begin, end, endptr, builder, allocator, flags, state);
+    });
+}
+
+namespace {
+// Handler of parseTokens() for JsonSaxParser, one event per token
+struct EventBuffer {
+    JsonEvent *it;
+    JsonEvent *last;
+
+    void push(JsonValue value, size_t length, int kind) {
+        it->value = value;
+        it->length = length;
+        it->kind = kind;
+        ++it;
+    }
+    void open(JsonTag tag, int) {
+        push(JsonValue(), 0, tag == JSON_ARRAY ? JSON_EVENT_START_ARRAY : JSON_EVENT_START_OBJECT);
+    }
+    bool close(JsonTag tag, int, JsonValue &o) {
+        push(JsonValue(), 0, tag == JSON_ARRAY ? JSON_EVENT_END_ARRAY : JSON_EVENT_END_OBJECT);
+        o = JsonValue(tag);
+        return true;
+    }
+    char *key(char *key, char *end) {
+        push(JsonValue(JSON_STRING, key), end - key, JSON_EVENT_KEY);
+        return key;
+    }
+    // containers are already reported by close()
+    bool value(JsonValue o, char *end, int) {
+        JsonTag tag = o.getTag();
+        if (tag == JSON_STRING)
+            push(o, end - o.toString(), tag);
+        else if (tag != JSON_ARRAY && tag != JSON_OBJECT)
+            push(o, 0, tag);
+        return true;
+    }
+    bool full() const {
+        return it == last;
+    }
+};
+} // namespace
+
+int JsonSaxParser::fill(char *&s, char *end, JsonAllocator &allocator, int flags) {
+    static_assert(FULL == JSON_INCOMPLETE, "fill() is parse giving up on full window");
+    EventBuffer handler{events, events + EVENT_COUNT};
+    char *endptr;
+    int status = parseBounded(s, end, &endptr, handler, allocator, flags, state);
+    count = handler.it - events;
+    s = endptr;
+    return status;
+}
+
+namespace {
+// Handler of parseTokens() for jsonValidate, which keeps nothing
+struct Validator {
+    void open(JsonTag, int) {
+    }
+    bool close(JsonTag tag, int, JsonValue &o) {
+        o = JsonValue(tag);
+        return true;
+    }
+    char *key(char *key, char *) {
+        return key;
+    }
+    bool value(JsonValue, char *, int) {
+        return true;
+    }
+    bool full() const {
+        return false;
+    }
+};
+} // namespace
+
+template <>
+struct ChecksOnly<Validator> {
+    static const bool value = true;
+};
+
+int jsonValidate(const char *begin, const char *end, const char **endptr, int flags) {
+    // only number right at the end is copied, to be terminated, and it is rarely longer
+    char buffer[256];
+    JsonAllocator allocator(buffer, sizeof(buffer));
+    JsonParseState state;
+    Validator validator;
+    char *rest;
+    int status = parseBounded((char *)begin, (char *)end, &rest, validator, allocator, flags & (JSON_PARSE_INDEXED | ~0xFFFF), state);
+    *endptr = rest;
+    return status;
+}
+
+JsonSchema::JsonSchema(const JsonField *fields, size_t count)
+    : fields(fields), count(count), multiplier(0), shift(0), slots(nullptr) {
+    // multipliers are tried until names hash to distinct slots, table grows if none does
+    for (int bits = 1; bits <= 16; ++bits) {
+        if (((size_t)1 << bits) < 2 * count)
+            continue;
+        uint16_t *table = (uint16_t *)calloc((size_t)1 << bits, sizeof(uint16_t));
+        if (table == nullptr)
+            return;
+        for (uint64_t m = 0x9E3779B97F4A7C15ULL, tries = 0; tries < 64; ++tries, m += 0x632BE59BD9B4E01AULL) {
+            size_t i = 0;
+            for (; i < count; ++i) {
+                uint16_t &slot = table[(hashBytes(fields[i].name, strlen(fields[i].name)) * m) >> (64 - bits)];
+                if (slot)
+                    break;
+                slot = i + 1;
             }
-            if ((node = (JsonNode *) allocator.allocate(sizeof(JsonNode))) == nullptr)
+            if (i == count) {
+                multiplier = m;
+                shift = 64 - bits;
+                slots = table;
+                return;
+            }
+            memset(table, 0, sizeof(uint16_t) << bits);
+        }
+        free(table);
+    }
+}
+
+JsonSchema::~JsonSchema() {
+    free(slots);
+}
+
+const JsonField *JsonSchema::find(const char *name, size_t length) const {
+    uint16_t slot = slots[(hashBytes(name, length) * multiplier) >> shift];
+    if (!slot)
+        return nullptr;
+    const JsonField *field = &fields[slot - 1];
+    return !strncmp(field->name, name, length) && !field->name[length] ? field : nullptr;
+}
+
+namespace {
+// Handler of parseTokens() for jsonDecode: members of schema objects go right to their
+// fields, JSON_FIELD_VALUE subtrees to DomBuilder, subtrees of unknown keys nowhere.
+// Mismatch can't fail open(), so it is kept in status and full() stops the parse.
+struct SchemaDecoder {
+    struct Frame {
+        const JsonSchema *schema;
+        char *object;
+    };
+    DomBuilder builder;
+    JsonField root;
+    char *object;
+    Frame frames[JSON_STACK_SIZE];
+    // innermost struct; subtree which is not one, INT_MAX outside of it, built or skipped
+    int typed;
+    int other;
+    bool building;
+    int depth;
+    // field of the last key of innermost struct, nullptr if unknown
+    const JsonField *field;
+    int status;
+
+    SchemaDecoder(void *object, const JsonSchema &schema, JsonValue *scratch, JsonAllocator &allocator, JsonParseState &state, int flags)
+        : builder{scratch, allocator, state, flags}, root{nullptr, 0, JSON_FIELD_OBJECT, &schema}, object((char *)object), typed(-1),
+          other(INT_MAX), building(false), depth(-1), field(&root), status(JSON_OK) {
+    }
+    char *target() const {
+        return (typed < 0 ? object : frames[typed].object) + field->offset;
+    }
+    void open(JsonTag tag, int pos) {
+        depth = pos;
+        if (pos >= other) {
+            if (building)
+                builder.open(tag, pos);
+            return;
+        }
+        if (!field || field->kind == JSON_FIELD_VALUE) {
+            other = pos;
+            building = field != nullptr;
+            if (building)
+                builder.open(tag, pos);
+            return;
+        }
+        if (field->kind != JSON_FIELD_OBJECT || tag != JSON_OBJECT) {
+            status = JSON_TYPE_MISMATCH;
+            return;
+        }
+        if (pos == JSON_STACK_SIZE) {
+            status = JSON_STACK_OVERFLOW;
+            return;
+        }
+        frames[pos] = Frame{field->schema, target()};
+        typed = pos;
+        field = nullptr;
+    }
+    bool close(JsonTag tag, int pos, JsonValue &o) {
+        depth = pos - 1;
+        if (pos >= other) {
+            if (pos == other)
+                other = INT_MAX;
+            if (building)
+                return builder.close(tag, pos, o);
+            o = JsonValue(tag);
+            return true;
+        }
+        // struct is done, value() of it has nothing to do
+        typed = pos - 1;
+        field = nullptr;
+        o = JsonValue(tag);
+        return true;
+    }
+    char *key(char *key, char *end) {
+        if (depth >= other)
+            return building ? builder.key(key, end) : key;
+        field = frames[typed].schema->find(key, end - key);
+        return key;
+    }
+    bool value(JsonValue o, char *end, int pos) {
+        if (pos >= other)
+            return !building || builder.value(o, end, pos);
+        if (!field)
+            return true;
+        JsonTag tag = o.getTag();
+        char *it = target();
+        switch (tag == JSON_NULL ? JSON_FIELD_VALUE : field->kind) {
+        case JSON_FIELD_BOOL:
+            if (tag != JSON_TRUE && tag != JSON_FALSE)
+                status = JSON_TYPE_MISMATCH;
+            else
+                *(bool *)it = tag == JSON_TRUE;
+            break;
+        case JSON_FIELD_INT:
+            if (tag != JSON_INTEGER || o.toInteger() < INT_MIN || o.toInteger() > INT_MAX)
+                status = JSON_TYPE_MISMATCH;
+            else
+                *(int *)it = o.toInteger();
+            break;
+        case JSON_FIELD_INT64:
+            if (tag != JSON_INTEGER)
+                status = JSON_TYPE_MISMATCH;
+            else
+                *(int64_t *)it = o.toInteger();
+            break;
+        case JSON_FIELD_FLOAT:
+        case JSON_FIELD_DOUBLE:
+            if (tag != JSON_NUMBER && tag != JSON_INTEGER) {
+                status = JSON_TYPE_MISMATCH;
+                break;
+            }
+            if (field->kind == JSON_FIELD_FLOAT)
+                *(float *)it = tag == JSON_NUMBER ? o.toNumber() : o.toInteger();
+            else
+                *(double *)it = tag == JSON_NUMBER ? o.toNumber() : o.toInteger();
+            break;
+        case JSON_FIELD_STRING:
+        case JSON_FIELD_STRING_VIEW:
+            if (tag != JSON_STRING)
+                status = JSON_TYPE_MISMATCH;
+            else if (field->kind == JSON_FIELD_STRING)
+                *(char **)it = o.toString();
+            else
+                *(JsonStringView *)it = JsonStringView{o.toString(), (size_t)(end - o.toString())};
+            break;
+        case JSON_FIELD_VALUE:
+            // null for other fields lands here too and leaves them as they were
+            if (field->kind == JSON_FIELD_VALUE)
+                *(JsonValue *)it = o;
+            break;
+        case JSON_FIELD_OBJECT:
+            status = JSON_TYPE_MISMATCH;
+            break;
+        }
+        field = nullptr;
+        return true;
+    }
+    bool full() const {
+        return status != JSON_OK;
+    }
+};
+} // namespace
+
+int jsonDecode(char *begin, char *end, char **endptr, void *object, const JsonSchema &schema, JsonAllocator &allocator, int flags) {
+    if (!schema.valid())
+        return JSON_ALLOCATION_FAILURE;
+    flags |= JSON_PARSE_INTEGERS;
+    JsonParseState state;
+    JsonValue scratch;
+    SchemaDecoder decoder(object, schema, &scratch, allocator, state, flags);
+    int status = parseBounded(begin, end, endptr, decoder, allocator, flags, state);
+    return decoder.status != JSON_OK ? decoder.status : status;
+}
+
+static inline char *lineEnd(char *s, char *end) {
+    char *newline = (char *)memchr(s, '\n', end - s);
+    return newline ? newline : end;
+}
+
+int jsonParseDocuments(char *begin, char *end, JsonDocument **documents, size_t *count, JsonAllocator &allocator, int flags) {
+    size_t capacity = 0;
+    *documents = nullptr;
+    *count = 0;
+    for (char *s = begin;;) {
+        while (s < end && isspace(*s))
+            ++s;
+        if (s == end)
+            return JSON_OK;
+
+        if (*count == capacity) {
+            // old array stays in allocator, doubling keeps the waste below the final size
+            capacity = capacity ? capacity * 2 : 16;
+            JsonDocument *array = (JsonDocument *)allocator.allocate(capacity * sizeof(JsonDocument));
+            if (array == nullptr)
                 return JSON_ALLOCATION_FAILURE;
-            tails[pos] = insertAfter(tails[pos], node);
-            tails[pos]->key = keys[pos];
-            keys[pos] = nullptr;
+            if (*count)
+                memcpy(array, *documents, *count * sizeof(JsonDocument));
+            *documents = array;
+        }
+        JsonDocument &document = (*documents)[(*count)++];
+        document.begin = s;
+
+        if (flags & JSON_PARSE_LINES) {
+            // line has no slack to pad, the next one starts right after it
+            char *line = lineEnd(s, end);
+            document.status = jsonParse(s, line, &document.endptr, &document.value, allocator, flags & ~JSON_PARSE_PADDED);
+            if (document.status == JSON_OK) {
+                for (s = document.endptr; s < line && isspace(*s); ++s)
+                    ;
+                if (s < line) {
+                    document.endptr = s;
+                    document.status = JSON_UNEXPECTED_CHARACTER;
+                }
+            }
+            s = line;
         } else {
-            if ((node = (JsonNode *) allocator.allocate(sizeof(JsonNode) - sizeof(char *))) == nullptr)
+            document.status = jsonParse(s, end, &document.endptr, &document.value, allocator, flags);
+            s = document.status == JSON_OK ? document.endptr : lineEnd(document.endptr, end);
+        }
+        if (document.status == JSON_ALLOCATION_FAILURE)
+            return JSON_ALLOCATION_FAILURE;
+    }
+}
+
+// Open addressing table with linear probing, of at least twice as many slots as members.
+// Slot keeps hash bits of the key and member number plus one, zero is empty.
+struct JsonHashSlot {
+    uint32_t hash;
+    uint32_t index;
+};
+
+struct JsonHashIndex {
+    size_t mask;
+    JsonHashSlot slots[1];
+};
+
+static inline uint64_t hashKey(const char *key) {
+    return hashBytes(key, strlen(key));
+}
+
+static JsonHashIndex *buildIndex(JsonNode *members, size_t count, JsonAllocator &allocator) {
+    size_t capacity = 16;
+    while (capacity < count * 2)
+        capacity *= 2;
+    JsonHashIndex *index = (JsonHashIndex *)allocator.allocate(sizeof(JsonHashIndex) + (capacity - 1) * sizeof(JsonHashSlot));
+    if (index == nullptr)
+        return nullptr;
+    index->mask = capacity - 1;
+    memset(index->slots, 0, capacity * sizeof(JsonHashSlot));
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t hash = hashKey(members[i].key);
+        for (size_t j = hash & index->mask;; j = (j + 1) & index->mask) {
+            JsonHashSlot &slot = index->slots[j];
+            if (!slot.index) {
+                slot.hash = (uint32_t)(hash >> 32);
+                slot.index = (uint32_t)i + 1;
+                break;
+            }
+            // repeated key: lookup finds the first one, as linear search does
+            if (slot.hash == (uint32_t)(hash >> 32) && !strcmp(members[slot.index - 1].key, members[i].key))
+                break;
+        }
+    }
+    return index;
+}
+
+static JsonNode *findLinear(JsonNode *node, const char *key) {
+    for (; node; node = node->next)
+        if (!strcmp(node->key, key))
+            return node;
+    return nullptr;
+}
+
+JsonNode *jsonFind(JsonValue object, const char *key) {
+    assert(object.getTag() == JSON_OBJECT);
+    JsonNode *members = object.toNode();
+    if (!members || !object.isContiguous())
+        return findLinear(members, key);
+    JsonHashIndex *index = ((JsonHashIndex **)members)[-2];
+    if (!index)
+        return findLinear(members, key);
+    uint64_t hash = hashKey(key);
+    for (size_t j = hash & index->mask;; j = (j + 1) & index->mask) {
+        JsonHashSlot &slot = index->slots[j];
+        if (!slot.index)
+            return nullptr;
+        if (slot.hash == (uint32_t)(hash >> 32) && !strcmp(members[slot.index - 1].key, key))
+            return &members[slot.index - 1];
+    }
+}
+
+JsonNode *jsonFind(JsonValue object, const char *key, JsonAllocator &allocator) {
+    assert(object.getTag() == JSON_OBJECT);
+    JsonNode *members = object.toNode();
+    if (members && object.isContiguous() && object.size() >= JSON_HASH_THRESHOLD && object.size() < UINT32_MAX) {
+        JsonHashIndex *&index = ((JsonHashIndex **)members)[-2];
+        // allocation failure just leaves object without index
+        if (!index)
+            index = buildIndex(members, object.size(), allocator);
+    }
+    return jsonFind(object, key);
+}
+
+JsonValue jsonMakeString(const char *s, size_t length, JsonAllocator &allocator) {
+    char *copy = copyString(s, length, allocator);
+    return copy ? JsonValue(JSON_STRING, copy) : JsonValue();
+}
+
+JsonValue jsonMakeInteger(int64_t x, JsonAllocator &allocator) {
+    JsonValue value;
+    // failure leaves it null
+    integerValue(x, value, allocator);
+    return value;
+}
+
+// Contiguous block becomes plain list: its next pointers already run through it, but
+// count and index before it would go stale
+static inline JsonNode *toList(JsonValue *container) {
+    JsonNode *head = container->toNode();
+    *container = JsonValue(container->getTag(), head);
+    return head;
+}
+
+// Lists are linked from head only, so tail is found by walking
+static JsonNode *lastNode(JsonValue container) {
+    JsonNode *tail = container.toNode();
+    if (tail)
+        while (tail->next)
+            tail = tail->next;
+    return tail;
+}
+
+// New node after tail of container, which becomes its tail
+static JsonNode *appendNode(JsonValue *container, JsonNode *&tail, size_t size, JsonAllocator &allocator) {
+    JsonNode *node = (JsonNode *)allocator.allocate(size);
+    if (node == nullptr)
+        return nullptr;
+    node->next = nullptr;
+    if (tail) {
+        toList(container);
+        tail->next = node;
+    } else {
+        *container = JsonValue(container->getTag(), node);
+    }
+    return tail = node;
+}
+
+static JsonNode *appendElement(JsonValue *array, JsonNode *&tail, JsonValue value, JsonAllocator &allocator) {
+    assert(array->getTag() == JSON_ARRAY);
+    JsonNode *node = appendNode(array, tail, JSON_ARRAY_NODE_SIZE, allocator);
+    if (node)
+        node->value = value;
+    return node;
+}
+
+static JsonNode *appendMember(JsonValue *object, JsonNode *&tail, const char *key, JsonValue value, JsonAllocator &allocator) {
+    assert(object->getTag() == JSON_OBJECT);
+    char *copy = copyString(key, strlen(key), allocator);
+    JsonNode *node = copy ? appendNode(object, tail, sizeof(JsonNode), allocator) : nullptr;
+    if (node) {
+        node->value = value;
+        node->key = copy;
+    }
+    return node;
+}
+
+JsonNode *jsonAppend(JsonValue *array, JsonValue value, JsonAllocator &allocator) {
+    JsonNode *tail = lastNode(*array);
+    return appendElement(array, tail, value, allocator);
+}
+
+JsonNode *jsonInsert(JsonValue *object, const char *key, JsonValue value, JsonAllocator &allocator) {
+    JsonNode *tail = lastNode(*object);
+    return appendMember(object, tail, key, value, allocator);
+}
+
+JsonBuilder::JsonBuilder(JsonValue container)
+    : tail(lastNode(container)), value(container) {
+    assert(value.getTag() == JSON_ARRAY || value.getTag() == JSON_OBJECT);
+}
+
+JsonNode *JsonBuilder::append(JsonValue element, JsonAllocator &allocator) {
+    return appendElement(&value, tail, element, allocator);
+}
+
+JsonNode *JsonBuilder::insert(const char *key, JsonValue member, JsonAllocator &allocator) {
+    return appendMember(&value, tail, key, member, allocator);
+}
+
+JsonNode *jsonSet(JsonValue *object, const char *key, JsonValue value, JsonAllocator &allocator) {
+    JsonNode *node = jsonFind(*object, key);
+    if (!node)
+        return jsonInsert(object, key, value, allocator);
+    node->value = value;
+    return node;
+}
+
+bool jsonRemove(JsonValue *container, JsonNode *node) {
+    assert(container->getTag() == JSON_ARRAY || container->getTag() == JSON_OBJECT);
+    JsonNode *prev = nullptr, *it = container->toNode();
+    for (; it && it != node; it = it->next)
+        prev = it;
+    if (!it)
+        return false;
+    JsonNode *head = toList(container);
+    if (prev)
+        prev->next = node->next;
+    else
+        *container = JsonValue(container->getTag(), head->next);
+    return true;
+}
+
+static inline char *skipSpace(char *s, char *end) {
+    while (s < end && isspace(*s))
+        ++s;
+    return s;
+}
+
+// End of value which starts at s, nullptr if it doesn't end before end
+static char *skipValue(char *s, char *end) {
+    if (*s == '"') {
+        s = stringEnd<true>(s + 1, end);
+        return s < end && *s == '"' ? s + 1 : nullptr;
+    }
+    if (*s == '[' || *s == '{') {
+        // blocks which can't close the value are skipped with popcounts
+        int64_t depth = 1;
+        for (StructureScanner scanner(s + 1, end); scanner.next();) {
+            if (depth > __builtin_popcountll(scanner.close)) {
+                depth += __builtin_popcountll(scanner.open) - __builtin_popcountll(scanner.close);
+                continue;
+            }
+            for (uint64_t bits = scanner.open | scanner.close; bits; bits &= bits - 1) {
+                int i = __builtin_ctzll(bits);
+                if (scanner.open >> i & 1)
+                    ++depth;
+                else if (--depth == 0)
+                    return scanner.block + i + 1;
+            }
+        }
+        return nullptr;
+    }
+    char *scalar = scalarEnd(s, end);
+    return scalar != s ? scalar : nullptr;
+}
+
+JsonLazy::JsonLazy(char *begin, char *end)
+    : s(skipSpace(begin, end)), end(end), k(nullptr) {
+    if (s == end)
+        s = nullptr;
+}
+
+JsonTag JsonLazy::getTag() const {
+    assert(s);
+    switch (*s) {
+    case '{':
+        return JSON_OBJECT;
+    case '[':
+        return JSON_ARRAY;
+    case '"':
+        return JSON_STRING;
+    case 't':
+        return JSON_TRUE;
+    case 'f':
+        return JSON_FALSE;
+    case 'n':
+        return JSON_NULL;
+    default:
+        return JSON_NUMBER;
+    }
+}
+
+// Element or member at p, right after the opening bracket or a comma
+JsonLazy JsonLazy::element(char *p, bool member) const {
+    p = skipSpace(p, end);
+    if (p == end || *p == ']' || *p == '}')
+        return JsonLazy();
+    if (!member)
+        return JsonLazy(p, end, nullptr);
+    char *key = p;
+    if (*p != '"' || (p = skipValue(p, end)) == nullptr)
+        return JsonLazy();
+    p = skipSpace(p, end);
+    if (p == end || *p != ':')
+        return JsonLazy();
+    p = skipSpace(p + 1, end);
+    return p < end ? JsonLazy(p, end, key) : JsonLazy();
+}
+
+JsonLazy JsonLazy::first() const {
+    if (!s || (*s != '[' && *s != '{'))
+        return JsonLazy();
+    return element(s + 1, *s == '{');
+}
+
+JsonLazy JsonLazy::next() const {
+    char *p;
+    if (!s || (p = skipValue(s, end)) == nullptr)
+        return JsonLazy();
+    p = skipSpace(p, end);
+    if (p == end || *p != ',')
+        return JsonLazy();
+    return element(p + 1, k != nullptr);
+}
+
+// Raw key in source, starting with its quote, equals key of given length
+static bool keyEquals(char *raw, char *end, const char *key, size_t length) {
+    char *rawEnd = stringEnd<true>(++raw, end);
+    if (!memchr(raw, '\\', rawEnd - raw))
+        return (size_t)(rawEnd - raw) == length && !memcmp(raw, key, length);
+    // escaped key is decoded by the parser, never longer than source
+    if ((size_t)(rawEnd - raw) < length)
+        return false;
+    char buffer[256];
+    JsonAllocator allocator(buffer, sizeof(buffer));
+    char *endptr;
+    JsonValue value;
+    return jsonParse(raw - 1, end, &endptr, &value, allocator, JSON_PARSE_NONDESTRUCTIVE) == JSON_OK &&
+           strlen(value.toString()) == length && !memcmp(value.toString(), key, length);
+}
+
+JsonLazy JsonLazy::find(const char *key) const {
+    if (!s || *s != '{')
+        return JsonLazy();
+    size_t length = strlen(key);
+    for (JsonLazy i = first(); i.valid(); i = i.next())
+        if (keyEquals(i.k, end, key, length))
+            return i;
+    return JsonLazy();
+}
+
+JsonLazy JsonLazy::at(size_t i) const {
+    if (!s || *s != '[')
+        return JsonLazy();
+    JsonLazy element = first();
+    for (; element.valid() && i; --i)
+        element = element.next();
+    return element;
+}
+
+int JsonLazy::parse(char **endptr, JsonValue *value, JsonAllocator &allocator, int flags) const {
+    if (!s) {
+        *endptr = end;
+        return JSON_BREAKING_BAD;
+    }
+    return jsonParse(s, end, endptr, value, allocator, (flags | JSON_PARSE_NONDESTRUCTIVE) & ~JSON_PARSE_PADDED);
+}
+
+// Trie node: one path segment, children are the next segments of paths through it
+struct JsonQuery::Node {
+    Node *children;
+    Node *next;
+    char *segment;
+    size_t length;
+    // segment as array index, SIZE_MAX if it isn't one
+    size_t index;
+    bool wildcard;
+    // paths which end here
+    size_t *paths;
+    size_t pathCount;
+    size_t pathCapacity;
+};
+
+int JsonQuery::compile(const char *const *paths, size_t count) {
+    allocator.deallocate();
+    if ((root = (Node *)allocator.allocate(sizeof(Node))) == nullptr)
+        return JSON_ALLOCATION_FAILURE;
+    memset(root, 0, sizeof(Node));
+    for (size_t i = 0; i < count; ++i) {
+        const char *p = paths[i];
+        if (*p && *p != '/')
+            return JSON_BAD_POINTER;
+        Node *node = root;
+        while (*p++ == '/') {
+            // decoded segment is never longer than encoded one
+            const char *segmentEnd = p + strcspn(p, "/");
+            char *segment = (char *)allocator.allocate(segmentEnd - p + 1);
+            if (segment == nullptr)
                 return JSON_ALLOCATION_FAILURE;
-            tails[pos] = insertAfter(tails[pos], node);
+            size_t length = 0;
+            for (; p < segmentEnd; ++p) {
+                if (*p == '~') {
+                    if (p[1] != '0' && p[1] != '1')
+                        return JSON_BAD_POINTER;
+                    segment[length++] = *++p == '0' ? '~' : '/';
+                } else {
+                    segment[length++] = *p;
+                }
+            }
+            segment[length] = 0;
+            bool wildcard = length == 1 && *segment == '*';
+
+            Node **child = &node->children;
+            while (*child && !((*child)->wildcard == wildcard && (*child)->length == length && !memcmp((*child)->segment, segment, length)))
+                child = &(*child)->next;
+            if (!*child) {
+                if ((*child = (Node *)allocator.allocate(sizeof(Node))) == nullptr)
+                    return JSON_ALLOCATION_FAILURE;
+                memset(*child, 0, sizeof(Node));
+                (*child)->segment = segment;
+                (*child)->length = length;
+                (*child)->wildcard = wildcard;
+                // array index: digits without leading zero
+                (*child)->index = length && (length == 1 || *segment != '0') && strspn(segment, "0123456789") == length ? strtoull(segment, nullptr, 10) : SIZE_MAX;
+            }
+            node = *child;
         }
-        tails[pos]->value = o;
+        if (node->pathCount == node->pathCapacity) {
+            size_t capacity = node->pathCapacity ? node->pathCapacity * 2 : 4;
+            size_t *array = (size_t *)allocator.allocate(capacity * sizeof(size_t));
+            if (array == nullptr)
+                return JSON_ALLOCATION_FAILURE;
+            if (node->pathCount)
+                memcpy(array, node->paths, node->pathCount * sizeof(size_t));
+            node->paths = array;
+            node->pathCapacity = capacity;
+        }
+        node->paths[node->pathCount++] = i;
     }
-    return JSON_BREAKING_BAD;
+    return JSON_OK;
+}
+
+namespace {
+struct QueryWalk {
+    char *end;
+    char **endptr;
+    JsonQueryCallback callback;
+    void *context;
+    JsonAllocator &allocator;
+    int flags;
+};
+} // namespace
+
+// Value at s against trie node: parses it for paths ending here, then goes on with members
+// or elements matching children
+template <typename Node>
+static int walk(const Node *node, char *s, QueryWalk &w) {
+    for (size_t i = 0; i < node->pathCount; ++i) {
+        JsonValue value;
+        int status = jsonParse(s, w.end, w.endptr, &value, w.allocator, (w.flags | JSON_PARSE_NONDESTRUCTIVE) & ~JSON_PARSE_PADDED);
+        if (status != JSON_OK)
+            return status;
+        w.callback(node->paths[i], value, w.context);
+    }
+    if (!node->children || (*s != '{' && *s != '['))
+        return JSON_OK;
+
+    // walk ends once every exact child, the first 64 of them, has been found
+    bool object = *s == '{';
+    bool wildcard = false;
+    uint64_t pending = 0;
+    int n = 0;
+    for (const Node *child = node->children; child; child = child->next, ++n)
+        if (child->wildcard || n >= 64)
+            wildcard = true;
+        else
+            pending |= 1ULL << n;
+
+    char *p = s + 1;
+    for (size_t index = 0;; ++index) {
+        p = skipSpace(p, w.end);
+        *w.endptr = p;
+        if (p == w.end)
+            return JSON_BREAKING_BAD;
+        if (*p == (object ? '}' : ']')) {
+            *w.endptr = p + 1;
+            return JSON_OK;
+        }
+        char *key = p;
+        if (object) {
+            if (*p != '"')
+                return JSON_UNQUOTED_KEY;
+            if ((p = skipValue(p, w.end)) == nullptr)
+                return JSON_BAD_STRING;
+            p = skipSpace(p, w.end);
+            *w.endptr = p;
+            if (p == w.end || *p != ':')
+                return JSON_UNEXPECTED_CHARACTER;
+            p = skipSpace(p + 1, w.end);
+            *w.endptr = p;
+            if (p == w.end)
+                return JSON_BREAKING_BAD;
+        }
+
+        n = 0;
+        for (const Node *child = node->children; child; child = child->next, ++n) {
+            if (!(child->wildcard || (object ? keyEquals(key, w.end, child->segment, child->length) : child->index == index)))
+                continue;
+            int status = walk(child, p, w);
+            if (status != JSON_OK)
+                return status;
+            if (n < 64)
+                pending &= ~(1ULL << n);
+        }
+        if (!pending && !wildcard)
+            return JSON_OK;
+
+        *w.endptr = p;
+        if ((p = skipValue(p, w.end)) == nullptr)
+            return JSON_BREAKING_BAD;
+        p = skipSpace(p, w.end);
+        *w.endptr = p;
+        if (p == w.end)
+            return JSON_BREAKING_BAD;
+        if (*p == (object ? '}' : ']')) {
+            *w.endptr = p + 1;
+            return JSON_OK;
+        }
+        if (*p++ != ',')
+            return JSON_UNEXPECTED_CHARACTER;
+    }
+}
+
+int JsonQuery::extract(char *begin, char *end, char **endptr, JsonQueryCallback callback, void *context, JsonAllocator &allocator, int flags) const {
+    char *s = skipSpace(begin, end);
+    *endptr = s;
+    if (s == end)
+        return JSON_BREAKING_BAD;
+    if (root == nullptr)
+        return JSON_OK;
+    QueryWalk w{end, endptr, callback, context, allocator, flags};
+    return walk(root, s, w);
+}
+
+// Smallest piece of work for a parallel parse worker
+#define JSON_PARALLEL_CHUNK (64 << 10)
+
+struct JsonChunk {
+    char *begin;
+    char *end;
+    JsonDocument *documents;
+    size_t count;
+    int status;
+};
+
+// Runs work(i, allocator) for every i below count on up to threads workers, the calling
+// thread included; each worker takes the next i in turn and has its own allocator.
+template <typename Work>
+static void runWorkers(JsonAllocator *allocators, int threads, size_t count, Work work) {
+    std::atomic<size_t> next(0);
+    auto worker = [&](JsonAllocator &allocator) {
+        for (size_t i; (i = next++) < count;)
+            work(i, allocator);
+    };
+    int workerCount = count < (size_t)threads ? (int)count : threads;
+    std::thread *workers = workerCount > 1 ? new std::thread[workerCount - 1] : nullptr;
+    for (int i = 1; i < workerCount; ++i)
+        workers[i - 1] = std::thread([&worker, allocators, i] { worker(allocators[i]); });
+    worker(allocators[0]);
+    for (int i = 1; i < workerCount; ++i)
+        workers[i - 1].join();
+    delete[] workers;
+}
+
+JsonParallelParser::JsonParallelParser(int threads)
+    : threads(threads > 0 ? threads : (int)std::thread::hardware_concurrency()) {
+    if (this->threads < 1)
+        this->threads = 1;
+    // one more for the merged array
+    allocators = new JsonAllocator[this->threads + 1];
+}
+
+JsonParallelParser::~JsonParallelParser() {
+    delete[] allocators;
+}
+
+int JsonParallelParser::parse(char *begin, char *end, JsonDocument **documents, size_t *count, int flags) {
+    for (int i = 0; i <= threads; ++i)
+        allocators[i].reset();
+
+    // several chunks per worker, so they even out
+    size_t size = end - begin;
+    size_t chunkSize = size / threads / 8;
+    if (chunkSize < JSON_PARALLEL_CHUNK)
+        chunkSize = JSON_PARALLEL_CHUNK;
+    size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+    JsonChunk *chunks = (JsonChunk *)allocators[threads].allocate(chunkCount * sizeof(JsonChunk));
+    if (chunks == nullptr)
+        return JSON_ALLOCATION_FAILURE;
+    // chunk starts at the first line after its offset; found before workers start, as
+    // decoding strings in place writes newlines
+    for (size_t i = 0; i < chunkCount; ++i) {
+        chunks[i].begin = begin;
+        if (i) {
+            char *newline = (char *)memchr(begin + i * chunkSize, '\n', size - i * chunkSize);
+            chunks[i].begin = chunks[i - 1].end = newline ? newline + 1 : end;
+        }
+        chunks[i].end = end;
+    }
+
+    runWorkers(allocators, threads, chunkCount, [&](size_t i, JsonAllocator &allocator) {
+        JsonChunk &chunk = chunks[i];
+        chunk.status = jsonParseDocuments(chunk.begin, chunk.end, &chunk.documents, &chunk.count, allocator, flags | JSON_PARSE_LINES);
+    });
+
+    *count = 0;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        if (chunks[i].status != JSON_OK)
+            return chunks[i].status;
+        *count += chunks[i].count;
+    }
+    *documents = (JsonDocument *)allocators[threads].allocate(*count * sizeof(JsonDocument));
+    if (*documents == nullptr)
+        return JSON_ALLOCATION_FAILURE;
+    JsonDocument *it = *documents;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        if (chunks[i].count)
+            memcpy(it, chunks[i].documents, chunks[i].count * sizeof(JsonDocument));
+        it += chunks[i].count;
+    }
+    return JSON_OK;
+}
+
+// Top-level array is cut right after commas between its elements, so every segment but
+// the last is a run of whole elements, each followed by a comma.
+struct JsonSegment {
+    char *begin;
+    char *end;
+    JsonNode *tail;
+    // JSON_PARSE_CONTIGUOUS: the segment's elements instead of tail
+    JsonNode *nodes;
+    size_t count;
+    JsonValue value;
+    char *endptr;
+    int status;
+};
+
+// Pre-scan for top-level array which starts right before s: finds commas between its
+// elements, the first one at least chunkSize bytes after the previous cut, 64 bytes at a
+// time with the same masks as indexed mode. Blocks where nesting depth can't get down to
+// one are skipped with popcounts, only the rest are walked bit by bit. Stops where the
+// array closes, so bytes after it are never touched. Returns number of cuts.
+static size_t splitArray(char *s, char *end, size_t chunkSize, char **cuts, size_t capacity) {
+    int64_t depth = 1;
+    size_t count = 0;
+    char *target = s + chunkSize;
+    for (StructureScanner scanner(s, end); count < capacity && scanner.next();) {
+        char *block = scanner.block;
+        int64_t lowest = depth - __builtin_popcountll(scanner.close);
+        if (lowest > 1 || (lowest > 0 && block + 64 <= target)) {
+            depth += __builtin_popcountll(scanner.open) - __builtin_popcountll(scanner.close);
+            continue;
+        }
+        for (uint64_t bits = scanner.op; bits; bits &= bits - 1) {
+            int i = __builtin_ctzll(bits);
+            if (scanner.open >> i & 1) {
+                ++depth;
+            } else if (scanner.close >> i & 1) {
+                if (--depth == 0)
+                    return count;
+            } else if (depth == 1 && block[i] == ',' && block + i >= target) {
+                cuts[count++] = block + i + 1;
+                if (count == capacity)
+                    break;
+                target = block + i + 1 + chunkSize;
+            }
+        }
+    }
+    return count;
+}
+
+template <bool Streaming>
+static int parseSegment(char *begin, char *end, char **endptr, JsonValue *value, JsonAllocator &allocator, int flags, JsonParseState &state) {
+    if (flags & JSON_PARSE_INDEXED) {
+        IndexCursor cursor(begin, end - begin);
+        return parse<true, Streaming>(begin, end, endptr, value, allocator, cursor, flags, state);
+    }
+    BoundedScanCursor cursor(begin, end);
+    return parse<true, Streaming>(begin, end, endptr, value, allocator, cursor, flags, state);
+}
+
+int JsonParallelParser::parseArray(char *begin, char *end, char **endptr, JsonValue *value, int flags) {
+    for (int i = 0; i <= threads; ++i)
+        allocators[i].reset();
+
+    char *s = begin;
+    while (s < end && isspace(*s))
+        ++s;
+    size_t size = end - s;
+    size_t chunkSize = size / threads / 8;
+    if (chunkSize < JSON_PARALLEL_CHUNK)
+        chunkSize = JSON_PARALLEL_CHUNK;
+    if (threads == 1 || size < 2 * chunkSize || *s != '[')
+        return jsonParse(begin, end, endptr, value, allocators[0], flags);
+
+    // one cut per chunkSize at most, found before workers decode strings in place
+    size_t capacity = size / chunkSize;
+    char **cuts = (char **)allocators[threads].allocate(capacity * sizeof(char *));
+    if (cuts == nullptr)
+        return JSON_ALLOCATION_FAILURE;
+    size_t segmentCount = splitArray(s + 1, end, chunkSize, cuts, capacity) + 1;
+    if (segmentCount == 1)
+        return jsonParse(begin, end, endptr, value, allocators[0], flags);
+    JsonSegment *segments = (JsonSegment *)allocators[threads].allocate(segmentCount * sizeof(JsonSegment));
+    if (segments == nullptr)
+        return JSON_ALLOCATION_FAILURE;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        segments[i].begin = i ? cuts[i - 1] : begin;
+        segments[i].end = i + 1 < segmentCount ? cuts[i] : end;
+    }
+
+    // segments after the first one start inside the array, the last one closes it;
+    // segments are adjacent, so there is no slack to pad
+    flags &= ~JSON_PARSE_PADDED;
+    runWorkers(allocators, threads, segmentCount, [&](size_t i, JsonAllocator &allocator) {
+        JsonSegment &segment = segments[i];
+        JsonParseState state;
+        if (i) {
+            state.pos = 0;
+            state.tails[0] = nullptr;
+            state.tags[0] = JSON_ARRAY;
+            state.keys[0] = nullptr;
+            state.starts[0] = 0;
+        }
+        if (i + 1 < segmentCount) {
+            segment.status = parseSegment<true>(segment.begin, segment.end, &segment.endptr, &segment.value, allocator, flags, state);
+            segment.tail = state.tails[0];
+            // elements are left on the node stack, which goes away with state
+            segment.count = state.size;
+            if (segment.status == JSON_INCOMPLETE && (flags & JSON_PARSE_CONTIGUOUS)) {
+                if ((segment.nodes = (JsonNode *)allocator.allocate(segment.count * sizeof(JsonNode))) != nullptr)
+                    memcpy(segment.nodes, state.nodes, segment.count * sizeof(JsonNode));
+                else
+                    segment.status = JSON_ALLOCATION_FAILURE;
+            }
+        } else {
+            segment.status = parseSegment<false>(segment.begin, segment.end, &segment.endptr, &segment.value, allocator, flags, state);
+        }
+    });
+
+    // the first failed segment fails where single threaded parse does, as all before it
+    // ended right after a comma inside the array
+    for (size_t i = 0; i + 1 < segmentCount; ++i) {
+        if (segments[i].status != JSON_INCOMPLETE) {
+            *endptr = segments[i].endptr;
+            return segments[i].status;
+        }
+    }
+    JsonSegment &last = segments[segmentCount - 1];
+    *endptr = last.endptr;
+    if (last.status != JSON_OK)
+        return last.status;
+
+    if (flags & JSON_PARSE_CONTIGUOUS) {
+        size_t count = last.value.size();
+        for (size_t i = 0; i + 1 < segmentCount; ++i)
+            count += segments[i].count;
+        char *it = allocateBlock(JSON_ARRAY, count, *value, allocators[threads]);
+        if (it == nullptr)
+            return JSON_ALLOCATION_FAILURE;
+        for (size_t i = 0; i + 1 < segmentCount; ++i)
+            it = copyNodes(JSON_ARRAY, it, segments[i].nodes, segments[i].count);
+        for (JsonNode *i = last.value.toNode(); i; i = i->next, it += JSON_ARRAY_NODE_SIZE) {
+            ((JsonNode *)it)->value = i->value;
+            ((JsonNode *)it)->next = (JsonNode *)(it + JSON_ARRAY_NODE_SIZE);
+        }
+        ((JsonNode *)(it - JSON_ARRAY_NODE_SIZE))->next = nullptr;
+        return JSON_OK;
+    }
+
+    // splice circular lists: tail's list goes on with the next segment's head
+    JsonNode *tail = nullptr;
+    for (size_t i = 0; i + 1 < segmentCount; ++i) {
+        JsonNode *segmentTail = segments[i].tail;
+        if (tail) {
+            JsonNode *head = tail->next;
+            tail->next = segmentTail->next;
+            segmentTail->next = head;
+        }
+        tail = segmentTail;
+    }
+    JsonNode *head = tail->next;
+    tail->next = last.value.toNode();
+    *value = JsonValue(JSON_ARRAY, head);
+    return JSON_OK;
+}
+
+bool JsonStreamParser::append(const char *s, size_t size) {
+    if (pendingSize + size >= pendingCapacity) {
+        // old buffer stays in allocator, doubling keeps the waste below the final size
+        size_t capacity = pendingCapacity ? pendingCapacity * 2 : 64;
+        while (capacity <= pendingSize + size)
+            capacity *= 2;
+        char *buffer = (char *)allocator.allocate(capacity);
+        if (buffer == nullptr)
+            return false;
+        if (pendingSize)
+            memcpy(buffer, pending, pendingSize);
+        pending = buffer;
+        pendingCapacity = capacity;
+    }
+    memcpy(pending + pendingSize, s, size);
+    pendingSize += size;
+    pending[pendingSize] = 0;
+    return true;
+}
+
+// Split string got its closing quote: last byte is a quote escaped by no odd backslash run.
+bool JsonStreamParser::pendingClosed() const {
+    size_t backslashes = 0;
+    if (pendingSize < 2 || pending[pendingSize - 1] != '"')
+        return false;
+    while (pending[pendingSize - 2 - backslashes] == '\\')
+        ++backslashes;
+    return backslashes % 2 == 0;
+}
+
+// Parses a completed split token with the byte after it, NUL terminated in own buffer.
+// Buffer is padded source, so NUL copied from a chunk is rejected like in the chunk.
+int JsonStreamParser::finishPending() {
+    char *endptr;
+    PaddedScanCursor cursor = {pending + pendingSize};
+    int result = parse<false, true>(pending, nullptr, &endptr, &document, allocator, cursor, flags | JSON_PARSE_PADDED, state);
+    stop = offset - pendingSize + (endptr - pending);
+    pending = nullptr;
+    pendingSize = pendingCapacity = 0;
+    if (result == JSON_OK)
+        complete = true;
+    return result == JSON_INCOMPLETE ? JSON_OK : result;
+}
+
+int JsonStreamParser::feed(char *chunk, size_t size) {
+    if (status != JSON_OK || complete)
+        return status;
+    char *s = chunk;
+    char *end = chunk + size;
+    if (pendingSize) {
+        // find where split token ends in this chunk, then take one more byte
+        bool closed = *pending != '"' || pendingClosed();
+        if (!closed) {
+            size_t backslashes = 0;
+            while (pending[pendingSize - 1 - backslashes] == '\\')
+                ++backslashes;
+            if (backslashes % 2 && s < end)
+                ++s;
+            s = stringEnd<true>(s, end);
+            if (s < end && !*s) {
+                stop = offset + (s - chunk);
+                return status = JSON_BAD_STRING;
+            }
+            if (s < end) {
+                ++s;
+                closed = true;
+            }
+        } else if (*pending != '"') {
+            s = scalarEnd(s, end);
+        }
+        bool whole = closed && s < end;
+        if (whole)
+            ++s;
+        if (!append(chunk, s - chunk))
+            return status = JSON_ALLOCATION_FAILURE;
+        offset += s - chunk;
+        if (!whole)
+            return JSON_OK;
+        if ((status = finishPending()) != JSON_OK || complete)
+            return status;
+    }
+
+    char *endptr;
+    int result;
+    if (flags & JSON_PARSE_INDEXED) {
+        IndexCursor cursor(s, end - s);
+        result = parse<true, true>(s, end, &endptr, &document, allocator, cursor, flags, state);
+    } else {
+        BoundedScanCursor cursor(s, end);
+        result = parse<true, true>(s, end, &endptr, &document, allocator, cursor, flags, state);
+    }
+    stop = offset + (endptr - s);
+    offset += end - s;
+    if (result == JSON_OK) {
+        complete = true;
+        return JSON_OK;
+    }
+    if (result != JSON_INCOMPLETE)
+        return status = result;
+    if (endptr < end && !append(endptr, end - endptr))
+        return status = JSON_ALLOCATION_FAILURE;
+    return JSON_OK;
+}
+
+int JsonStreamParser::finish(JsonValue *value) {
+    if (status == JSON_OK && !complete && pendingSize) {
+        if (*pending == '"' && !pendingClosed()) {
+            stop = offset;
+            status = JSON_BAD_STRING;
+        } else {
+            status = finishPending();
+        }
+    }
+    if (status == JSON_OK && !complete)
+        status = JSON_BREAKING_BAD;
+    if (status == JSON_OK)
+        *value = document;
+    return status;
+}
+
+static const uint64_t powersOf10Integer[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL};
+
+static const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Decimal digits of x, two at a time from the end
+static inline char *writeDigits(char *s, uint64_t x) {
+    char digits[20];
+    char *it = digits + sizeof(digits);
+    for (; x >= 100; x /= 100)
+        memcpy(it -= 2, digitPairs + 2 * (x % 100), 2);
+    if (x >= 10)
+        memcpy(it -= 2, digitPairs + 2 * x, 2);
+    else
+        *--it = (char)('0' + x);
+    size_t n = digits + sizeof(digits) - it;
+    memcpy(s, it, n);
+    return s + n;
+}
+
+// Grisu2 (Loitsch, "Printing floating-point numbers quickly and accurately with integers")
+// on 64-bit f * 2^e. Cached powers of ten are the ones of five Eisel-Lemire uses.
+struct DiyFp {
+    uint64_t f;
+    int e;
+};
+
+static inline DiyFp operator*(DiyFp a, DiyFp b) {
+    uint64_t high, low;
+    multiply(a.f, b.f, high, low);
+    return DiyFp{high + (low >> 63), a.e + b.e + 64};
+}
+
+static inline DiyFp normalize(DiyFp x) {
+    int shift = __builtin_clzll(x.f);
+    return DiyFp{x.f << shift, x.e - shift};
+}
+
+// Moves last digit towards w while it stays within the bounds and gets closer
+static inline void grisuRound(char *digits, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance) {
+    while (rest < distance && delta - rest >= tenKappa && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+        --digits[length - 1];
+        rest += tenKappa;
+    }
+}
+
+// 10^q as normalized f * 2^e, rounded. Subnormals need powers past the table, those are
+// 10^308 * 5^(q - 308) * 2^(q - 308) with the product kept to 192 bits.
+static inline DiyFp cachedPower(int q) {
+    if (q <= 308) {
+        const uint64_t *power = powersOf5 + 2 * (q + 342);
+        return DiyFp{power[0] + (power[1] >> 63), (((152170 + 65536) * q) >> 16) - 63};
+    }
+    int k = q - 308;
+    uint64_t five = 1;
+    for (int i = 0; i < k; ++i)
+        five *= 5;
+    const uint64_t *power = powersOf5 + 2 * (308 + 342);
+    uint64_t high, middle, low, carry;
+    multiply(power[1], five, carry, low);
+    multiply(power[0], five, high, middle);
+    middle += carry;
+    high += middle < carry;
+    int shift = __builtin_clzll(high);
+    uint64_t f = shift ? high << shift | middle >> (64 - shift) : high;
+    uint64_t rest = middle << shift | (shift ? low >> (64 - shift) : 0);
+    int e = (((152170 + 65536) * 308) >> 16) - 63 + k + 64 - shift;
+    // rounding up all ones carries into the next power of two
+    if (rest >> 63 && ++f == 0)
+        return DiyFp{1ULL << 63, e + 1};
+    return DiyFp{f, e};
+}
+
+// Digits of shortest decimal in (low, high), closest to w; x = digits * 10^exponent.
+static void grisu2(double x, char *digits, int &length, int &exponent) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    uint64_t fraction = bits & ((1ULL << 52) - 1);
+    int biased = (int)(bits >> 52);
+    DiyFp v = biased ? DiyFp{fraction | (1ULL << 52), biased - 1075} : DiyFp{fraction, -1074};
+
+    // halfway to neighbours, lower one is closer when fraction is zero
+    DiyFp high = normalize(DiyFp{(v.f << 1) + 1, v.e - 1});
+    DiyFp low = fraction == 0 && biased > 1 ? DiyFp{(v.f << 2) - 1, v.e - 2} : DiyFp{(v.f << 1) - 1, v.e - 1};
+    low.f <<= low.e - high.e;
+    low.e = high.e;
+
+    // 10^q brings binary exponent of high * 10^q to [-35, -32], so integral part of it
+    // takes 32 bits and fraction leaves room to multiply by ten
+    int q = -((-(-36 - high.e) * 78913) >> 18);
+    DiyFp c = cachedPower(q);
+    DiyFp w = normalize(v) * c;
+    high = high * c;
+    low = low * c;
+    // products are off by up to one unit, so bounds shrink by one
+    ++low.f;
+    --high.f;
+    uint64_t delta = high.f - low.f;
+    uint64_t distance = high.f - w.f;
+    exponent = -q;
+
+    DiyFp one{1ULL << -high.e, high.e};
+    uint32_t integral = (uint32_t)(high.f >> -one.e);
+    uint64_t rest = high.f & (one.f - 1);
+    int kappa = 10;
+    while (kappa > 1 && integral < powersOf10Integer[kappa - 1])
+        --kappa;
+    length = 0;
+    while (kappa > 0) {
+        uint32_t d;
+        // constant divisors become multiplications
+        switch (kappa) {
+#define DIGIT(k, power10)       \
+    case k:                     \
+        d = integral / power10; \
+        integral %= power10;    \
+        break;
+            DIGIT(10, 1000000000)
+            DIGIT(9, 100000000)
+            DIGIT(8, 10000000)
+            DIGIT(7, 1000000)
+            DIGIT(6, 100000)
+            DIGIT(5, 10000)
+            DIGIT(4, 1000)
+            DIGIT(3, 100)
+            DIGIT(2, 10)
+#undef DIGIT
+        default:
+            d = integral;
+            integral = 0;
+        }
+        if (d || length)
+            digits[length++] = (char)('0' + d);
+        --kappa;
+        uint64_t remainder = ((uint64_t)integral << -one.e) + rest;
+        if (remainder <= delta) {
+            exponent += kappa;
+            grisuRound(digits, length, delta, remainder, powersOf10Integer[kappa] << -one.e, distance);
+            return;
+        }
+    }
+    for (;;) {
+        rest *= 10;
+        delta *= 10;
+        char d = (char)(rest >> -one.e);
+        if (d || length)
+            digits[length++] = (char)('0' + d);
+        rest &= one.f - 1;
+        --kappa;
+        if (rest < delta) {
+            exponent += kappa;
+            grisuRound(digits, length, delta, rest, one.f, -kappa < 20 ? distance * powersOf10Integer[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+JsonWriter::~JsonWriter() {
+    free(buffer);
+}
+
+// Room for n more bytes: buffered output goes to sink first, if there is one
+bool JsonWriter::reserve(size_t n) {
+    if (size + n <= capacity)
+        return true;
+    if (status != JSON_OK)
+        return false;
+    if (sink && size && flush() != JSON_OK)
+        return false;
+    if (size + n > capacity) {
+        size_t grown = capacity ? capacity * 2 : (sink ? JSON_WRITER_BUFFER : 256);
+        while (grown < size + n)
+            grown *= 2;
+        char *p = (char *)realloc(buffer, grown);
+        if (p == nullptr) {
+            status = JSON_ALLOCATION_FAILURE;
+            return false;
+        }
+        buffer = p;
+        capacity = grown;
+    }
+    return true;
+}
+
+int JsonWriter::flush() {
+    if (status == JSON_OK && sink && size) {
+        if (!sink(buffer, size, context))
+            status = JSON_WRITE_FAILURE;
+        size = 0;
+    }
+    return status;
+}
+
+void JsonWriter::newline(int level) {
+    if (indent && reserve(1 + (size_t)indent * level)) {
+        buffer[size++] = '\n';
+        memset(buffer + size, ' ', (size_t)indent * level);
+        size += (size_t)indent * level;
+    }
+}
+
+template <bool Bounded>
+void JsonWriter::writeString(const char *s, const char *end) {
+    if (!reserve(1))
+        return;
+    buffer[size++] = '"';
+    for (;;) {
+        // parser's scan stops at the terminator too
+        const char *run = scanString<Bounded>((char *)s, (char *)end);
+        if (!reserve(run - s + 6))
+            return;
+        memcpy(buffer + size, s, run - s);
+        size += run - s;
+        char *it = buffer + size;
+        if (Bounded ? run >= end : !*run) {
+            *it++ = '"';
+            size = it - buffer;
+            return;
+        }
+        switch (*run) {
+        case '"':
+        case '\\':
+            *it++ = '\\';
+            *it++ = *run;
+            break;
+        case '\b':
+            memcpy(it, "\\b", 2);
+            it += 2;
+            break;
+        case '\f':
+            memcpy(it, "\\f", 2);
+            it += 2;
+            break;
+        case '\n':
+            memcpy(it, "\\n", 2);
+            it += 2;
+            break;
+        case '\r':
+            memcpy(it, "\\r", 2);
+            it += 2;
+            break;
+        case '\t':
+            memcpy(it, "\\t", 2);
+            it += 2;
+            break;
+        default:
+            // other control characters, NUL of bounded string and DEL, which the parser rejects raw
+            memcpy(it, "\\u00", 4);
+            it[4] = "0123456789abcdef"[(unsigned char)*run >> 4];
+            it[5] = "0123456789abcdef"[*run & 0xF];
+            it += 6;
+        }
+        size = it - buffer;
+        s = run + 1;
+    }
+}
+
+void JsonWriter::writeDouble(double x) {
+    // digits, dot, exponent and the zeros of up to 21 integral digits
+    if (!reserve(32))
+        return;
+    char *s = buffer + size;
+    if (x != x || x - x != 0) {
+        // NaN and infinity have no JSON form
+        memcpy(s, "null", 4);
+        size += 4;
+        return;
+    }
+    if (signbit(x)) {
+        *s++ = '-';
+        x = -x;
+    }
+    if (x == 0) {
+        memcpy(s, "0.0", 3);
+        size = s + 3 - buffer;
+        return;
+    }
+    char digits[20];
+    int length, exponent;
+    grisu2(x, digits, length, exponent);
+
+    // x = 0.digits * 10^point
+    int point = length + exponent;
+    if (exponent >= 0 && point <= 21) {
+        // 1234e7 -> 12340000000.0
+        memcpy(s, digits, length);
+        memset(s + length, '0', exponent);
+        s += point;
+        memcpy(s, ".0", 2);
+        s += 2;
+    } else if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memcpy(s, digits, point);
+        s[point] = '.';
+        memcpy(s + point + 1, digits + point, length - point);
+        s += length + 1;
+    } else if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        memcpy(s, "0.", 2);
+        memset(s + 2, '0', -point);
+        memcpy(s + 2 - point, digits, length);
+        s += 2 - point + length;
+    } else {
+        // 1234e30 -> 1.234e33
+        *s++ = digits[0];
+        if (length > 1) {
+            *s++ = '.';
+            memcpy(s, digits + 1, length - 1);
+            s += length - 1;
+        }
+        *s++ = 'e';
+        if (point - 1 < 0)
+            *s++ = '-';
+        s = writeDigits(s, point - 1 < 0 ? 1 - point : point - 1);
+    }
+    size = s - buffer;
+}
+
+void JsonWriter::writeInteger(int64_t x) {
+    if (!reserve(20))
+        return;
+    char *s = buffer + size;
+    if (x < 0)
+        *s++ = '-';
+    size = writeDigits(s, x < 0 ? 0 - (uint64_t)x : (uint64_t)x) - buffer;
+}
+
+void JsonWriter::writeValue(JsonValue value, int level, bool lengths) {
+    switch (value.getTag()) {
+    case JSON_NUMBER:
+        writeDouble(value.toNumber());
+        break;
+    case JSON_INTEGER:
+        writeInteger(value.toInteger());
+        break;
+    case JSON_STRING:
+        if (lengths)
+            writeString<true>(value.toString(), value.toString() + value.toStringView().length);
+        else
+            writeString<false>(value.toString(), nullptr);
+        break;
+    case JSON_ARRAY:
+    case JSON_OBJECT: {
+        bool object = value.getTag() == JSON_OBJECT;
+        if (!reserve(1))
+            return;
+        buffer[size++] = object ? '{' : '[';
+        JsonNode *node = value.toNode();
+        for (JsonNode *i = node; i; i = i->next) {
+            if (i != node && reserve(1))
+                buffer[size++] = ',';
+            newline(level + 1);
+            if (object) {
+                if (lengths)
+                    writeString<true>(i->key, i->key + i->keyView().length);
+                else
+                    writeString<false>(i->key, nullptr);
+                if (reserve(2)) {
+                    buffer[size++] = ':';
+                    if (indent)
+                        buffer[size++] = ' ';
+                }
+            }
+            writeValue(i->value, level + 1, lengths);
+        }
+        if (node)
+            newline(level);
+        if (reserve(1))
+            buffer[size++] = object ? '}' : ']';
+        break;
+    }
+    case JSON_TRUE:
+        if (reserve(4)) {
+            memcpy(buffer + size, "true", 4);
+            size += 4;
+        }
+        break;
+    case JSON_FALSE:
+        if (reserve(5)) {
+            memcpy(buffer + size, "false", 5);
+            size += 5;
+        }
+        break;
+    case JSON_NULL:
+        if (reserve(4)) {
+            memcpy(buffer + size, "null", 4);
+            size += 4;
+        }
+        break;
+    }
+}
+
+int JsonWriter::write(JsonValue value, int flags) {
+    if (status == JSON_OK)
+        writeValue(value, 0, flags & JSON_PARSE_STRING_LENGTHS);
+    return status;
+}
+
+static inline size_t stringLength(const char *s, bool lengths) {
+    return lengths ? ((const size_t *)s)[-1] : strlen(s);
+}
+
+// Copy with length before it stays aligned for the next one
+static inline size_t stringSize(size_t length, bool lengths) {
+    return lengths ? (sizeof(size_t) + length + 8) & ~(size_t)7 : length + 1;
+}
+
+// Bytes a clone of value takes: nodes and boxed integers, then strings
+static void cloneSize(JsonValue value, size_t &nodes, size_t &strings, bool lengths) {
+    JsonTag tag = value.getTag();
+    switch (tag) {
+    case JSON_STRING:
+        strings += stringSize(stringLength(value.toString(), lengths), lengths);
+        break;
+    case JSON_INTEGER:
+        if (!(value.getPayload() & 1))
+            nodes += sizeof(int64_t);
+        break;
+    case JSON_ARRAY:
+    case JSON_OBJECT:
+        if (!value.toNode())
+            break;
+        nodes += blockHeader(tag);
+        for (auto node : value) {
+            nodes += nodeSize(tag);
+            if (tag == JSON_OBJECT)
+                strings += stringSize(stringLength(node->key, lengths), lengths);
+            cloneSize(node->value, nodes, strings, lengths);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static inline char *cloneString(const char *s, char *&strings, bool lengths) {
+    size_t length = stringLength(s, lengths);
+    char *copy = strings;
+    strings += stringSize(length, lengths);
+    if (lengths) {
+        *(size_t *)copy = length;
+        copy += sizeof(size_t);
+    }
+    return (char *)memcpy(copy, s, length + 1);
+}
+
+static JsonValue cloneValue(JsonValue value, char *&nodes, char *&strings, bool lengths) {
+    JsonTag tag = value.getTag();
+    switch (tag) {
+    case JSON_STRING:
+        return JsonValue(JSON_STRING, cloneString(value.toString(), strings, lengths));
+    case JSON_INTEGER:
+        if (!(value.getPayload() & 1)) {
+            *(int64_t *)nodes = value.toInteger();
+            nodes += sizeof(int64_t);
+            return JsonValue(JSON_INTEGER, nodes - sizeof(int64_t));
+        }
+        return value;
+    case JSON_ARRAY:
+    case JSON_OBJECT: {
+        if (!value.toNode())
+            return value;
+        size_t count = value.size();
+        JsonValue copy;
+        char *it = placeBlock(nodes, tag, count, copy);
+        nodes = it + count * nodeSize(tag);
+        for (auto node : value) {
+            JsonNode *target = (JsonNode *)it;
+            target->value = cloneValue(node->value, nodes, strings, lengths);
+            target->next = node->next ? (JsonNode *)(it += nodeSize(tag)) : nullptr;
+            if (tag == JSON_OBJECT)
+                target->key = cloneString(node->key, strings, lengths);
+        }
+        return copy;
+    }
+    default:
+        return value;
+    }
+}
+
+int jsonClone(JsonValue value, JsonValue *copy, JsonAllocator &allocator, int flags) {
+    bool lengths = flags & JSON_PARSE_STRING_LENGTHS;
+    size_t nodes = 0, strings = 0;
+    cloneSize(value, nodes, strings, lengths);
+    char *block = nodes + strings ? (char *)allocator.allocate(nodes + strings) : nullptr;
+    if (nodes + strings && block == nullptr)
+        return JSON_ALLOCATION_FAILURE;
+    char *stringPart = block + nodes;
+    *copy = cloneValue(value, block, stringPart, lengths);
+    return JSON_OK;
+}
+
+// Snapshot image starts with this header, byte order tells native images from others
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t order;
+    uint64_t size;
+    uint64_t root;
+};
+
+static const char snapshotMagic[8] = {'g', 'a', 's', 'o', 'n', 1, 0, 0};
+static const uint64_t snapshotOrder = 0x0102030405060708ULL;
+
+namespace {
+// Image grows in one malloc block, every piece of it at 8-byte aligned offset
+struct SnapshotBuilder {
+    char *image;
+    size_t size;
+    size_t capacity;
+    bool failed;
+
+    size_t allocate(size_t n) {
+        n = (n + 7) & ~(size_t)7;
+        if (size + n > capacity) {
+            size_t grown = capacity ? capacity * 2 : 4096;
+            while (grown < size + n)
+                grown *= 2;
+            char *p = (char *)realloc(image, grown);
+            if (p == nullptr) {
+                failed = true;
+                return 0;
+            }
+            image = p;
+            capacity = grown;
+        }
+        // padding is zeroed, so equal values give equal images
+        memset(image + size, 0, n);
+        size += n;
+        return size - n;
+    }
+    size_t string(const char *s) {
+        size_t length = strlen(s) + 1;
+        size_t offset = allocate(length);
+        if (!failed)
+            memcpy(image + offset, s, length);
+        return offset;
+    }
+    // Value of the image, children follow their block
+    uint64_t add(JsonValue value) {
+        size_t offset;
+        switch (value.getTag()) {
+        case JSON_STRING:
+            offset = string(value.toString());
+            break;
+        case JSON_INTEGER:
+            if (value.getPayload() & 1)
+                return value.ival;
+            offset = allocate(sizeof(int64_t));
+            if (!failed)
+                *(int64_t *)(image + offset) = value.toInteger();
+            break;
+        case JSON_ARRAY:
+        case JSON_OBJECT: {
+            size_t words = value.getTag() == JSON_OBJECT ? 2 : 1;
+            size_t count = value.size();
+            offset = allocate((1 + words * count) * sizeof(uint64_t));
+            if (failed)
+                return 0;
+            ((uint64_t *)(image + offset))[0] = count;
+            size_t i = 0;
+            for (auto node : value) {
+                // image moves as it grows, so it is indexed anew after every add
+                uint64_t element = add(node->value);
+                size_t key = words == 2 ? string(node->key) : 0;
+                if (failed)
+                    return 0;
+                ((uint64_t *)(image + offset))[1 + words * i] = element;
+                if (words == 2)
+                    ((uint64_t *)(image + offset))[2 + words * i] = key;
+                ++i;
+            }
+            break;
+        }
+        default:
+            return value.ival;
+        }
+        return JsonValue(value.getTag(), (void *)offset).ival;
+    }
+};
+} // namespace
+
+int jsonSnapshot(JsonValue value, JsonSink sink, void *context) {
+    SnapshotBuilder builder{nullptr, 0, 0, false};
+    builder.allocate(sizeof(SnapshotHeader));
+    uint64_t root = builder.add(value);
+    int status = JSON_ALLOCATION_FAILURE;
+    if (!builder.failed) {
+        SnapshotHeader *header = (SnapshotHeader *)builder.image;
+        memcpy(header->magic, snapshotMagic, sizeof(header->magic));
+        header->order = snapshotOrder;
+        header->size = builder.size;
+        header->root = root;
+        status = sink(builder.image, builder.size, context) ? JSON_OK : JSON_WRITE_FAILURE;
+    }
+    free(builder.image);
+    return status;
+}
+
+namespace {
+// Array or object of image being checked, with key of the last member checked still due
+struct SnapshotFrame {
+    const uint64_t *block;
+    size_t count;
+    size_t i;
+    bool object;
+    bool key;
+};
+
+// Walks image in the order jsonSnapshot laid it out: every block, boxed integer and string
+// starts right where the previous one ended. Image which passes has no offset outside of
+// it, no overlap and no cycle, and the walk reads it once.
+struct SnapshotChecker {
+    const char *image;
+    size_t size;
+    size_t next;
+    SnapshotFrame *stack;
+    size_t depth;
+    size_t capacity;
+
+    bool piece(uint64_t offset, size_t n) {
+        if (offset != next || n > size - next)
+            return false;
+        next += n;
+        return true;
+    }
+    bool string(uint64_t offset) {
+        if (offset != next || offset >= size)
+            return false;
+        const char *end = (const char *)memchr(image + offset, 0, size - offset);
+        return end && piece(offset, (end - image - offset + 8) & ~(size_t)7);
+    }
+    int value(uint64_t ival) {
+        JsonValue value;
+        value.ival = ival;
+        switch (value.getTag()) {
+        case JSON_NUMBER:
+        case JSON_TRUE:
+        case JSON_FALSE:
+        case JSON_NULL:
+            return JSON_OK;
+        case JSON_INTEGER:
+            return value.getPayload() & 1 || piece(value.getPayload(), sizeof(int64_t)) ? JSON_OK : JSON_BAD_SNAPSHOT;
+        case JSON_STRING:
+            return string(value.getPayload()) ? JSON_OK : JSON_BAD_SNAPSHOT;
+        case JSON_ARRAY:
+        case JSON_OBJECT: {
+            size_t words = value.getTag() == JSON_OBJECT ? 2 : 1;
+            if (value.getPayload() != next || size - next < sizeof(uint64_t))
+                return JSON_BAD_SNAPSHOT;
+            const uint64_t *block = (const uint64_t *)(image + next);
+            // count word and the words of elements or members fit before the end
+            if (block[0] > ((size - next) / sizeof(uint64_t) - 1) / words)
+                return JSON_BAD_SNAPSHOT;
+            if (depth == capacity) {
+                size_t grown = capacity ? capacity * 2 : 64;
+                SnapshotFrame *p = (SnapshotFrame *)realloc(stack, grown * sizeof(SnapshotFrame));
+                if (p == nullptr)
+                    return JSON_ALLOCATION_FAILURE;
+                stack = p;
+                capacity = grown;
+            }
+            stack[depth++] = {block, (size_t)block[0], 0, words == 2, false};
+            next += (1 + words * block[0]) * sizeof(uint64_t);
+            return JSON_OK;
+        }
+        default:
+            return JSON_BAD_SNAPSHOT;
+        }
+    }
+    int check(uint64_t root) {
+        int status = value(root);
+        while (status == JSON_OK && depth) {
+            SnapshotFrame &frame = stack[depth - 1];
+            if (frame.key) {
+                // key follows the value of its member
+                frame.key = false;
+                if (!string(frame.block[2 * frame.i]))
+                    status = JSON_BAD_SNAPSHOT;
+            } else if (frame.i == frame.count) {
+                --depth;
+            } else {
+                uint64_t element = frame.block[1 + (frame.object ? 2 * frame.i : frame.i)];
+                frame.key = frame.object;
+                ++frame.i;
+                status = value(element);
+            }
+        }
+        free(stack);
+        return status == JSON_OK && next != size ? JSON_BAD_SNAPSHOT : status;
+    }
+};
+} // namespace
+
+int jsonLoadSnapshot(const char *image, size_t size, JsonView *root) {
+    const SnapshotHeader *header = (const SnapshotHeader *)image;
+    if (size < sizeof(SnapshotHeader) || memcmp(header->magic, snapshotMagic, sizeof(header->magic)) || header->order != snapshotOrder ||
+        header->size != size)
+        return JSON_BAD_SNAPSHOT;
+    SnapshotChecker checker{image, size, sizeof(SnapshotHeader), nullptr, 0, 0};
+    int status = checker.check(header->root);
+    if (status == JSON_OK) {
+        JsonValue value;
+        value.ival = header->root;
+        *root = JsonView(image, value);
+    }
+    return status;
+}
+
+JsonView JsonView::find(const char *key) const {
+    assert(getTag() == JSON_OBJECT);
+    const uint64_t *members = block();
+    for (size_t i = 0; i < members[0]; ++i)
+        if (!strcmp(base + members[2 + 2 * i], key))
+            return at(i);
+    return JsonView();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+static size_t mappingSize(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + JSON_PADDING + page - 1) & ~(page - 1);
+}
+
+char *jsonMapFile(const char *filename, size_t *size, bool writable) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return nullptr;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        errno = ENODEV;
+        return nullptr;
+    }
+    *size = (size_t)st.st_size;
+
+    // zero pages for padding first, then file on top; tail of its last page is zero as well
+    size_t length = mappingSize(*size);
+    char *p = (char *)mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != (char *)MAP_FAILED && *size &&
+        mmap(p, *size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(p, length);
+        p = (char *)MAP_FAILED;
+    }
+    close(fd);
+    return p == (char *)MAP_FAILED ? nullptr : p;
+}
+
+void jsonUnmapFile(char *source, size_t size) {
+    munmap(source, mappingSize(size));
+}
+#else
+char *jsonMapFile(const char *filename, size_t *size, bool) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return nullptr;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *p = (char *)calloc(*size + JSON_PADDING, 1);
+    if (p && fread(p, 1, *size, fp) != *size) {
+        free(p);
+        p = nullptr;
+    }
+    fclose(fp);
+    return p;
+}
+
+void jsonUnmapFile(char *source, size_t) {
+    free(source);
 }
+#endif
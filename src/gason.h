@@ -11,11 +11,18 @@ enum JsonTag {
     JSON_OBJECT,
     JSON_TRUE,
     JSON_FALSE,
+    JSON_INTEGER,
     JSON_NULL = 0xF
 };
 
 struct JsonNode;
 
+// Bytes of string, which may hold NUL, and their count without terminator
+struct JsonStringView {
+    const char *data;
+    size_t length;
+};
+
 #define JSON_VALUE_PAYLOAD_MASK 0x00007FFFFFFFFFFFULL
 #define JSON_VALUE_NAN_MASK 0x7FF8000000000000ULL
 #define JSON_VALUE_TAG_MASK 0xF
@@ -46,22 +53,71 @@ union JsonValue {
         assert(getTag() == JSON_NUMBER);
         return fval;
     }
+    int64_t toInteger() const {
+        assert(getTag() == JSON_INTEGER);
+        uint64_t payload = getPayload();
+        // odd payload is 46-bit integer shifted left by one, even is pointer to boxed int64_t
+        if (payload & 1)
+            return (int64_t)(payload << 17) >> 18;
+        return *(int64_t *)payload;
+    }
     char *toString() const {
         assert(getTag() == JSON_STRING);
         return (char *)getPayload();
     }
+    // Only for strings parsed with JSON_PARSE_STRING_LENGTHS
+    JsonStringView toStringView() const {
+        const char *s = toString();
+        return JsonStringView{s, ((const size_t *)s)[-1]};
+    }
     JsonNode *toNode() const {
         assert(getTag() == JSON_ARRAY || getTag() == JSON_OBJECT);
-        return (JsonNode *)getPayload();
+        // lowest bit marks contiguous nodes, pointers are 8-byte aligned
+        return (JsonNode *)(getPayload() & ~(uint64_t)1);
+    }
+    // Nodes are one block with their count, see JSON_PARSE_CONTIGUOUS
+    bool isContiguous() const {
+        assert(getTag() == JSON_ARRAY || getTag() == JSON_OBJECT);
+        return getPayload() & 1;
     }
+    // Number of elements or members, walks the list unless contiguous
+    size_t size() const;
+    // Element or member number i, nullptr if out of range; constant time if contiguous
+    JsonNode *at(size_t i) const;
 };
 
 struct JsonNode {
     JsonValue value;
     JsonNode *next;
     char *key;
+
+    // Only for keys parsed with JSON_PARSE_STRING_LENGTHS or JSON_PARSE_INTERN_KEYS
+    JsonStringView keyView() const {
+        return JsonStringView{key, ((const size_t *)key)[-1]};
+    }
 };
 
+// Array nodes have no key, so they are shorter
+#define JSON_ARRAY_NODE_SIZE (sizeof(JsonNode) - sizeof(char *))
+
+inline size_t JsonValue::size() const {
+    if (isContiguous())
+        return ((size_t *)toNode())[-1];
+    size_t size = 0;
+    for (JsonNode *i = toNode(); i; i = i->next)
+        ++size;
+    return size;
+}
+
+inline JsonNode *JsonValue::at(size_t i) const {
+    if (isContiguous())
+        return i < size() ? (JsonNode *)((char *)toNode() + i * (getTag() == JSON_ARRAY ? JSON_ARRAY_NODE_SIZE : sizeof(JsonNode))) : nullptr;
+    JsonNode *node = toNode();
+    for (; node && i; --i)
+        node = node->next;
+    return node;
+}
+
 struct JsonIterator {
     JsonNode *p;
 
@@ -97,7 +153,11 @@ inline JsonIterator end(JsonValue) {
     XX(UNEXPECTED_CHARACTER, "unexpected character") \
     XX(UNQUOTED_KEY, "unquoted key")                 \
     XX(BREAKING_BAD, "breaking bad")                 \
-    XX(ALLOCATION_FAILURE, "allocation failure")
+    XX(ALLOCATION_FAILURE, "allocation failure")     \
+    XX(BAD_POINTER, "bad pointer")                   \
+    XX(WRITE_FAILURE, "write failure")               \
+    XX(TYPE_MISMATCH, "type mismatch")               \
+    XX(BAD_SNAPSHOT, "bad snapshot")
 
 enum JsonErrno {
 #define XX(no, str) JSON_##no,
@@ -107,29 +167,753 @@ enum JsonErrno {
 
 const char *jsonStrError(int err);
 
+#define JSON_ZONE_SIZE 4096
+#define JSON_MAX_ZONE_SIZE (1 << 20)
+#define JSON_TRIM_SIZE (16 << 20)
+
+// Where JsonAllocator gets its zones from; free gets the same size allocate got.
+struct JsonBacking {
+    void *(*allocate)(size_t size, void *context);
+    void (*free)(void *p, size_t size, void *context);
+    void *context;
+};
+
+// malloc/free, the default
+extern const JsonBacking jsonMallocBacking;
+// Anonymous mmap, zones of 2 MiB and bigger are rounded up to 2 MiB and ask for huge pages
+// (MAP_HUGETLB, then transparent huge pages). Meant for big documents with big zones, e.g.
+// JsonAllocator allocator(JSON_HUGE_PAGE_SIZE, 64 << 20, jsonMmapBacking);
+extern const JsonBacking jsonMmapBacking;
+#define JSON_HUGE_PAGE_SIZE (2 << 20)
+
+// Counters of parses and zones, filled only when gason.cpp is built with JSON_STATS=1
+// (cmake -DGASON_STATS=ON) for allocators it is attached to by setStats(). They add up
+// over every parse with the allocator until reset().
+struct JsonStats {
+    // source bytes up to endptr
+    size_t bytes;
+    // values by JsonTag, arrays and objects are counted when they close
+    size_t values[JSON_NULL + 1];
+    size_t keys;
+    // escape sequences decoded in strings and keys
+    size_t escapes;
+    // deepest nesting reached
+    int maxDepth;
+    // jsonParse calls and those which failed
+    size_t parses;
+    size_t failures;
+    // everything got from backing, oversized blocks too, and its bytes
+    size_t zones;
+    size_t zoneBytes;
+    // blocks too big for a zone, allocated apart
+    size_t oversized;
+    size_t oversizedBytes;
+    // Called after every jsonParse with its status and wall time, the stats include it
+    void (*hook)(const JsonStats &stats, int status, uint64_t nanoseconds, void *context);
+    void *context;
+
+    JsonStats(void (*hook)(const JsonStats &, int, uint64_t, void *) = nullptr, void *context = nullptr)
+        : hook(hook), context(context) {
+        reset();
+    }
+    // Zeroes counters, hook stays
+    void reset() {
+        bytes = keys = escapes = parses = failures = zones = zoneBytes = oversized = oversizedBytes = 0;
+        for (auto &count : values)
+            count = 0;
+        maxDepth = 0;
+    }
+};
+
 class JsonAllocator {
     struct Zone {
         Zone *next;
         size_t used;
-    } *head;
+        size_t size;
+    } *head, *large, *buffer;
+    size_t zoneSize;
+    size_t maxZoneSize;
+    const JsonBacking *backing;
+    // open addressing table of interned strings, allocated from zones
+    struct InternSlot;
+    InternSlot *internSlots;
+    size_t internMask;
+    size_t internCount;
+    JsonStats *stats;
+
+    Zone *allocateZone(size_t size);
+    void freeZones(Zone *zone);
 
 public:
-    JsonAllocator() : head(nullptr) {};
+    // Zones start at zoneSize bytes and double up to maxZoneSize; blocks which don't
+    // fit the next zone get individual allocations kept apart from zones.
+    JsonAllocator(size_t zoneSize = JSON_ZONE_SIZE, size_t maxZoneSize = JSON_MAX_ZONE_SIZE, const JsonBacking &backing = jsonMallocBacking)
+        : head(nullptr), large(nullptr), buffer(nullptr), zoneSize(zoneSize), maxZoneSize(maxZoneSize), backing(&backing), internSlots(nullptr), internMask(0), internCount(0), stats(nullptr) {
+    }
+    // Allocates from caller-owned memory (e.g. on stack) first and only spills to backing
+    // when it is exhausted. The buffer must outlive the allocator and is never freed.
+    JsonAllocator(void *buffer, size_t size, size_t zoneSize = JSON_ZONE_SIZE, size_t maxZoneSize = JSON_MAX_ZONE_SIZE, const JsonBacking &backing = jsonMallocBacking);
     JsonAllocator(const JsonAllocator &) = delete;
     JsonAllocator &operator=(const JsonAllocator &) = delete;
-    JsonAllocator(JsonAllocator &&x) : head(x.head) {
-        x.head = nullptr;
+    JsonAllocator(JsonAllocator &&x)
+        : head(x.head), large(x.large), buffer(x.buffer), zoneSize(x.zoneSize), maxZoneSize(x.maxZoneSize), backing(x.backing),
+          internSlots(x.internSlots), internMask(x.internMask), internCount(x.internCount), stats(x.stats) {
+        x.head = x.large = x.buffer = nullptr;
+        x.internSlots = nullptr;
+        x.internMask = x.internCount = 0;
     }
     JsonAllocator &operator=(JsonAllocator &&x) {
         head = x.head;
-        x.head = nullptr;
+        large = x.large;
+        buffer = x.buffer;
+        zoneSize = x.zoneSize;
+        maxZoneSize = x.maxZoneSize;
+        backing = x.backing;
+        internSlots = x.internSlots;
+        internMask = x.internMask;
+        internCount = x.internCount;
+        stats = x.stats;
+        x.head = x.large = x.buffer = nullptr;
+        x.internSlots = nullptr;
+        x.internMask = x.internCount = 0;
         return *this;
     }
     ~JsonAllocator() {
         deallocate();
     }
     void *allocate(size_t size);
+    // Makes sure next size bytes are bumped from a single zone, e.g. reserve(sourceSize / 2)
+    // before parsing avoids most zone allocations for typical documents.
+    bool reserve(size_t size);
+    // Rewinds allocator for reuse, keeping the largest zone if it can hold everything
+    // allocated since the last reset (or one new zone which can), so steady-state parsing
+    // does no malloc/free. Nothing is kept over trimSize, so one huge document doesn't
+    // pin memory forever.
+    void reset(size_t trimSize = JSON_TRIM_SIZE);
+    // Frees all zones, a caller-owned buffer becomes the first zone again.
     void deallocate();
+    // Canonical copy of string in this allocator, the same pointer for the same bytes until
+    // reset or deallocate; nullptr if out of memory. With JSON_PARSE_INTERN_KEYS all keys
+    // are interned, so key == allocator.intern("name") replaces strcmp.
+    char *intern(const char *s, size_t length);
+    char *intern(const char *s);
+    // Stats to fill, nullptr (the default) stops counting; see JsonStats
+    void setStats(JsonStats *stats) {
+        this->stats = stats;
+    }
+    JsonStats *getStats() const {
+        return stats;
+    }
+};
+
+enum JsonParseFlags {
+    // Two-stage parse: find all tokens with SIMD first, then build values from that index
+    JSON_PARSE_INDEXED = 1 << 0,
+    // Integers which fit int64_t become JSON_INTEGER instead of JSON_NUMBER
+    JSON_PARSE_INTEGERS = 1 << 1,
+    // Source is never modified, strings are copied to allocator, so read-only memory can be parsed
+    JSON_PARSE_NONDESTRUCTIVE = 1 << 2,
+    // Bounded source is followed by at least JSON_PADDING writable slack bytes: terminator
+    // is written at end and the NUL terminated fast path runs without bounds checks
+    JSON_PARSE_PADDED = 1 << 3,
+    // jsonParseDocuments: JSON Lines, every line holds one document
+    JSON_PARSE_LINES = 1 << 4,
+    // Nodes of every array and object are one block, allocated when it closes, so they
+    // come one after another in memory and size() and at(i) need no list walk
+    JSON_PARSE_CONTIGUOUS = 1 << 5,
+    // Keys are interned in allocator, equal keys are equal pointers
+    JSON_PARSE_INTERN_KEYS = 1 << 6,
+    // Strings and keys are copied to allocator with their length before them, so
+    // toStringView() and keyView() need no strlen and keep embedded \u0000
+    JSON_PARSE_STRING_LENGTHS = 1 << 7
+};
+
+// Nesting limit without JSON_PARSE_MAX_DEPTH
+#define JSON_MAX_DEPTH 1024
+// Flag which sets nesting limit to depth levels (up to 32767), deeper document fails with
+// JSON_STACK_OVERFLOW
+#define JSON_PARSE_MAX_DEPTH(depth) ((depth) << 16)
+
+// Slack bytes JSON_PARSE_PADDED expects, zero bytes guaranteed after the end of jsonMapFile result
+#define JSON_PADDING 64
+
+int jsonParse(char *str, char **endptr, JsonValue *value, JsonAllocator &allocator, int flags = 0);
+// Parses [begin, end) without a terminator, bytes from end on never affect the result
+int jsonParse(char *begin, char *end, char **endptr, JsonValue *value, JsonAllocator &allocator, int flags = 0);
+
+// Checks [begin, end) with the grammar of jsonParse and never writes to it. Nothing is
+// allocated unless nesting goes past JSON_STACK_SIZE levels or a long number ends input.
+// Only JSON_PARSE_INDEXED and JSON_PARSE_MAX_DEPTH flags apply. As with jsonParse,
+// endptr is right after the value on success, at the error otherwise.
+int jsonValidate(const char *begin, const char *end, const char **endptr, int flags = 0);
+
+#define JSON_HASH_THRESHOLD 16
+
+// Member of object with given key, the first one if key is repeated, or nullptr.
+JsonNode *jsonFind(JsonValue object, const char *key);
+// Same, but a contiguous object of JSON_HASH_THRESHOLD members or more gets hash index
+// from allocator on first lookup, so the following ones take constant time. Index is
+// kept in the object, so one first lookup must not race with other lookups.
+JsonNode *jsonFind(JsonValue object, const char *key, JsonAllocator &allocator);
+
+// Building and patching trees in place, new nodes and strings come from allocator; empty
+// array or object to start with is JsonValue(JSON_ARRAY) or JsonValue(JSON_OBJECT).
+// Containers are passed by pointer, as adding or removing a node may change their value:
+// contiguous one becomes a list, so size() walks it from then on. Removed nodes stay in
+// allocator until reset. Strings and keys are copied with their length, see keyView().
+// Copy of length bytes of s, or null value if out of memory
+JsonValue jsonMakeString(const char *s, size_t length, JsonAllocator &allocator);
+// Integer in payload, or boxed in allocator if it doesn't fit; null if out of memory
+JsonValue jsonMakeInteger(int64_t x, JsonAllocator &allocator);
+// New last element of array, nullptr if out of memory. Walks the array to its end, so
+// JsonBuilder is the way to build big ones.
+JsonNode *jsonAppend(JsonValue *array, JsonValue value, JsonAllocator &allocator);
+// New last member of object, even if key is already there; walks it as jsonAppend does
+JsonNode *jsonInsert(JsonValue *object, const char *key, JsonValue value, JsonAllocator &allocator);
+// Replaces value of the first member with key, or inserts one
+JsonNode *jsonSet(JsonValue *object, const char *key, JsonValue value, JsonAllocator &allocator);
+// Unlinks node from array or object, false if it isn't there
+bool jsonRemove(JsonValue *container, JsonNode *node);
+
+// Array or object under construction which keeps its last node, so append() and insert()
+// take constant time. value is valid all along; changes to it other than through builder
+// must not remove its last node.
+class JsonBuilder {
+    JsonNode *tail;
+
+public:
+    JsonValue value;
+
+    // New empty JSON_ARRAY or JSON_OBJECT
+    explicit JsonBuilder(JsonTag tag)
+        : tail(nullptr), value(tag) {
+    }
+    // Continues existing one, walking it once; use value of builder from then on
+    explicit JsonBuilder(JsonValue container);
+    // Same as jsonAppend and jsonInsert
+    JsonNode *append(JsonValue element, JsonAllocator &allocator);
+    JsonNode *insert(const char *key, JsonValue member, JsonAllocator &allocator);
+};
+
+// On-demand access: value is just its position in source, nothing is parsed until asked
+// for. Members and elements are found by skipping siblings with structure-only SIMD scan,
+// so subtrees never visited cost no nodes and no unescaping, and aren't validated either.
+// parse() is jsonParse of the value alone, always nondestructive, so source stays intact.
+class JsonLazy {
+    char *s;
+    char *end;
+    // key of object member, nullptr for array element
+    char *k;
+
+    JsonLazy(char *s, char *end, char *k)
+        : s(s), end(end), k(k) {
+    }
+    JsonLazy element(char *p, bool member) const;
+
+public:
+    JsonLazy()
+        : s(nullptr), end(nullptr), k(nullptr) {
+    }
+    // Root value of [begin, end)
+    JsonLazy(char *begin, char *end);
+    // False for missing member or element, end of iteration or malformed source
+    bool valid() const {
+        return s != nullptr;
+    }
+    // Guessed from the first byte, so numbers are always JSON_NUMBER
+    JsonTag getTag() const;
+    // Start of the value in source
+    char *source() const {
+        return s;
+    }
+    // First element of array or member of object, and the one after this
+    JsonLazy first() const;
+    JsonLazy next() const;
+    // Key of this member as string value
+    JsonLazy key() const {
+        return JsonLazy(k, end, nullptr);
+    }
+    // Member with given key (escaped keys are decoded to compare), element number i
+    JsonLazy find(const char *key) const;
+    JsonLazy at(size_t i) const;
+    int parse(char **endptr, JsonValue *value, JsonAllocator &allocator, int flags = 0) const;
+};
+
+typedef void (*JsonQueryCallback)(size_t path, JsonValue value, void *context);
+
+// Set of JSON Pointers (RFC 6901) compiled into a trie, "*" segment matches every member
+// or element. extract() walks source along the trie: members and elements no path goes
+// through are skipped with structure-only scan, unparsed, and walk ends as soon as all
+// exact paths below a value are found. Matched values are parsed nondestructively and
+// passed to callback with index of the path as the walk meets them, in source order for
+// different values, allocating nothing else.
+class JsonQuery {
+    struct Node;
+    Node *root;
+    JsonAllocator allocator;
+
+public:
+    JsonQuery()
+        : root(nullptr) {
+    }
+    // JSON_BAD_POINTER if a path is neither empty nor starts with '/' or has bad '~' escape
+    int compile(const char *const *paths, size_t count);
+    // Errors are jsonParse ones, endptr is where it failed. On success endptr is right after
+    // the last byte walk read: the end of the value walked through, or of the last match if
+    // walk ended early. Without paths nothing is read, endptr is at the value.
+    int extract(char *begin, char *end, char **endptr, JsonQueryCallback callback, void *context, JsonAllocator &allocator, int flags = 0) const;
+};
+
+struct JsonDocument {
+    JsonValue value;
+    int status;
+    char *begin;
+    // after the document, or where it failed
+    char *endptr;
+};
+
+// Parses documents following each other in [begin, end): concatenated JSON, or JSON Lines
+// with JSON_PARSE_LINES. All of them share one allocator, which holds the array of *count
+// documents too. A failed document doesn't stop the batch: parsing resumes on the next
+// line. Returns JSON_OK or JSON_ALLOCATION_FAILURE.
+int jsonParseDocuments(char *begin, char *end, JsonDocument **documents, size_t *count, JsonAllocator &allocator, int flags = 0);
+
+// Parses JSON Lines on several threads. Buffer is cut at newlines into chunks, idle workers
+// take the next one in turn, so a long line holds up only its own chunk. Every worker
+// allocates from its own JsonAllocator, documents come back in input order and are valid
+// until the next parse or parseArray.
+class JsonParallelParser {
+    JsonAllocator *allocators;
+    int threads;
+
+public:
+    // Zero threads means one per hardware thread
+    explicit JsonParallelParser(int threads = 0);
+    JsonParallelParser(const JsonParallelParser &) = delete;
+    JsonParallelParser &operator=(const JsonParallelParser &) = delete;
+    ~JsonParallelParser();
+    // Same as jsonParseDocuments with JSON_PARSE_LINES
+    int parse(char *begin, char *end, JsonDocument **documents, size_t *count, int flags = 0);
+    // Same as bounded jsonParse, but single huge top-level array is pre-scanned for commas
+    // between its elements, parsed in pieces on several threads and stitched back together.
+    // Anything else, or an array too small to split, is parsed on the calling thread.
+    int parseArray(char *begin, char *end, char **endptr, JsonValue *value, int flags = 0);
+};
+
+// Levels of nesting parse state keeps in place, deeper ones move to heap
+#define JSON_STACK_SIZE 32
+
+// Open arrays and objects of a parse in progress. Levels of the first JSON_STACK_SIZE
+// are in the arrays right here, deeper document moves them to heap and doubles it.
+struct JsonParseState {
+    JsonNode **tails;
+    JsonTag *tags;
+    char **keys;
+    int pos;
+    // levels there is room for
+    int depth;
+    bool separator;
+    // JSON_PARSE_CONTIGUOUS: nodes of open arrays and objects wait on this stack until they
+    // close, nodes of the innermost one start at starts[pos]
+    JsonNode *nodes;
+    size_t size;
+    size_t capacity;
+    size_t *starts;
+
+    JsonNode *shallowTails[JSON_STACK_SIZE];
+    JsonTag shallowTags[JSON_STACK_SIZE];
+    char *shallowKeys[JSON_STACK_SIZE];
+    size_t shallowStarts[JSON_STACK_SIZE];
+
+    JsonParseState()
+        : tails(shallowTails), tags(shallowTags), keys(shallowKeys), pos(-1), depth(JSON_STACK_SIZE), separator(true), nodes(nullptr), size(0), capacity(0), starts(shallowStarts) {
+    }
+    JsonParseState(const JsonParseState &) = delete;
+    JsonParseState &operator=(const JsonParseState &) = delete;
+    ~JsonParseState();
+    // Room for more levels, up to limit; false if out of memory
+    bool grow(int limit);
+};
+
+// Resumable parser for input arriving in chunks, e.g. from a socket: parse state is kept
+// between feed() calls, so parsing overlaps with I/O. Strings are decoded in place, so
+// chunks must outlive values unless JSON_PARSE_NONDESTRUCTIVE copies them to allocator.
+// A token split by chunk boundary is always copied to allocator.
+class JsonStreamParser {
+    JsonParseState state;
+    JsonAllocator &allocator;
+    int flags;
+    int status;
+    bool complete;
+    JsonValue document;
+    char *pending;
+    size_t pendingSize;
+    size_t pendingCapacity;
+    size_t offset;
+    size_t stop;
+
+    bool append(const char *s, size_t size);
+    bool pendingClosed() const;
+    int finishPending();
+
+public:
+    JsonStreamParser(JsonAllocator &allocator, int flags = 0)
+        : allocator(allocator), flags(flags), status(JSON_OK), complete(false), pending(nullptr), pendingSize(0), pendingCapacity(0), offset(0), stop(0) {
+    }
+    // Parses next chunk and returns error code, which sticks. Bytes after a complete
+    // document are ignored.
+    int feed(char *chunk, size_t size);
+    // End of input: parses token left from the last chunk and returns the document.
+    int finish(JsonValue *value);
+    // Whole document parsed, no more chunks needed
+    bool done() const {
+        return complete;
+    }
+    // Stream offset of the error (or of the end of document)
+    size_t position() const {
+        return stop;
+    }
+};
+
+// JsonEvent kinds besides JsonTag of values
+enum {
+    JSON_EVENT_KEY = 8,
+    JSON_EVENT_START_ARRAY,
+    JSON_EVENT_END_ARRAY,
+    JSON_EVENT_START_OBJECT,
+    JSON_EVENT_END_OBJECT
+};
+
+struct JsonEvent {
+    // scalar, string or key
+    JsonValue value;
+    // of string or key
+    size_t length;
+    int kind;
+};
+
+// No-op handler methods, a handler derives from it and hides the ones it needs
+struct JsonSaxHandler {
+    void onNull() {}
+    void onBool(bool) {}
+    void onNumber(double) {}
+    // JSON_PARSE_INTEGERS only
+    void onInteger(int64_t) {}
+    void onString(char *, size_t) {}
+    void onKey(char *, size_t) {}
+    void onStartArray() {}
+    void onEndArray() {}
+    void onStartObject() {}
+    void onEndObject() {}
+};
+
+// SAX parse without building a tree: the parser fills a window of events, parse() then
+// calls handler methods for them, resolved at compile time. Strings are decoded in place
+// (or copied to allocator with JSON_PARSE_NONDESTRUCTIVE) and NUL terminated; nothing
+// else is allocated, but integers over 46 bits and number at the very end of input.
+// Events before an error are all delivered, so handler must not trust them on failure.
+class JsonSaxParser {
+    enum { EVENT_COUNT = 256, FULL = -1 };
+
+    JsonParseState state;
+    JsonEvent events[EVENT_COUNT];
+    size_t count;
+
+    // Next window of events, FULL with s moved past them if there are more to come
+    int fill(char *&s, char *end, JsonAllocator &allocator, int flags);
+
+public:
+    template <typename Handler>
+    int parse(char *begin, char *end, char **endptr, Handler &handler, JsonAllocator &allocator, int flags = 0);
+};
+
+template <typename Handler>
+int JsonSaxParser::parse(char *begin, char *end, char **endptr, Handler &handler, JsonAllocator &allocator, int flags) {
+    state.pos = -1;
+    state.separator = true;
+    for (char *s = begin;;) {
+        int status = fill(s, end, allocator, flags);
+        for (const JsonEvent *e = events; e != events + count; ++e) {
+            switch (e->kind) {
+            case JSON_NUMBER:
+                handler.onNumber(e->value.toNumber());
+                break;
+            case JSON_INTEGER:
+                handler.onInteger(e->value.toInteger());
+                break;
+            case JSON_STRING:
+                handler.onString(e->value.toString(), e->length);
+                break;
+            case JSON_TRUE:
+                handler.onBool(true);
+                break;
+            case JSON_FALSE:
+                handler.onBool(false);
+                break;
+            case JSON_NULL:
+                handler.onNull();
+                break;
+            case JSON_EVENT_KEY:
+                handler.onKey(e->value.toString(), e->length);
+                break;
+            case JSON_EVENT_START_ARRAY:
+                handler.onStartArray();
+                break;
+            case JSON_EVENT_END_ARRAY:
+                handler.onEndArray();
+                break;
+            case JSON_EVENT_START_OBJECT:
+                handler.onStartObject();
+                break;
+            case JSON_EVENT_END_OBJECT:
+                handler.onEndObject();
+                break;
+            }
+        }
+        if (status != FULL) {
+            *endptr = s;
+            return status;
+        }
+    }
+}
+
+// JsonWriter output, false if it failed
+typedef bool (*JsonSink)(const char *data, size_t size, void *context);
+
+// Bytes JsonWriter gathers before it hands them to the sink
+#define JSON_WRITER_BUFFER 65536
+
+// Serializer, compact or indented by indent spaces per level. Strings are copied in runs
+// found by the same SIMD scan the parser uses. Doubles are Grisu2 digits, which always
+// read back as the same double and are the shortest ones but for about 0.1% of doubles;
+// integral ones keep ".0" so they stay JSON_NUMBER. NaN and infinities become null.
+// Without a sink output grows in a buffer, with one it goes there every JSON_WRITER_BUFFER
+// bytes and on flush(). Errors stick until clear().
+class JsonWriter {
+    char *buffer;
+    size_t size;
+    size_t capacity;
+    JsonSink sink;
+    void *context;
+    int indent;
+    int status;
+
+    bool reserve(size_t n);
+    void newline(int level);
+    // bounded string ends at end, with NUL written as \u0000, other one at NUL
+    template <bool Bounded>
+    void writeString(const char *s, const char *end);
+    void writeDouble(double x);
+    void writeInteger(int64_t x);
+    void writeValue(JsonValue value, int level, bool lengths);
+
+public:
+    explicit JsonWriter(int indent = 0)
+        : buffer(nullptr), size(0), capacity(0), sink(nullptr), context(nullptr), indent(indent), status(0) {
+    }
+    JsonWriter(JsonSink sink, void *context, int indent = 0)
+        : buffer(nullptr), size(0), capacity(0), sink(sink), context(context), indent(indent), status(0) {
+    }
+    JsonWriter(const JsonWriter &) = delete;
+    JsonWriter &operator=(const JsonWriter &) = delete;
+    ~JsonWriter();
+    // Appends value; JSON_ALLOCATION_FAILURE or JSON_WRITE_FAILURE from the sink.
+    // With JSON_PARSE_STRING_LENGTHS value has string lengths, so strings and keys are
+    // written whole, embedded \u0000 included.
+    int write(JsonValue value, int flags = 0);
+    // Hands buffered output to sink
+    int flush();
+    // Output without sink, not terminated
+    const char *data() const {
+        return buffer;
+    }
+    size_t length() const {
+        return size;
+    }
+    // Drops output and error, keeps the buffer
+    void clear() {
+        size = 0;
+        status = 0;
+    }
 };
 
-int jsonParse(char *str, char **endptr, JsonValue *value, JsonAllocator &allocator);
+// Deep copy of value, strings included, in one allocation from allocator, so it doesn't
+// need source or allocator of value any more. Arrays and objects of copy are contiguous.
+// With JSON_PARSE_STRING_LENGTHS value has string lengths and copy keeps them.
+int jsonClone(JsonValue value, JsonValue *copy, JsonAllocator &allocator, int flags = 0);
+
+// Read-only value of a snapshot image, same NaN-boxing as JsonValue but payloads are
+// offsets from the image start: arrays and objects point at their count, followed by
+// elements (values) or members (value and key offset); strings and boxed integers
+// are where they point. Invalid view is not a value, see valid().
+class JsonView {
+    const char *base;
+    JsonValue value;
+
+    const uint64_t *block() const {
+        assert(getTag() == JSON_ARRAY || getTag() == JSON_OBJECT);
+        return (const uint64_t *)(base + value.getPayload());
+    }
+
+public:
+    JsonView()
+        : base(nullptr) {
+    }
+    JsonView(const char *base, JsonValue value)
+        : base(base), value(value) {
+    }
+    bool valid() const {
+        return base != nullptr;
+    }
+    JsonTag getTag() const {
+        assert(base);
+        return value.getTag();
+    }
+    double toNumber() const {
+        return value.toNumber();
+    }
+    int64_t toInteger() const {
+        assert(getTag() == JSON_INTEGER);
+        return value.getPayload() & 1 ? value.toInteger() : *(const int64_t *)(base + value.getPayload());
+    }
+    const char *toString() const {
+        assert(getTag() == JSON_STRING);
+        return base + value.getPayload();
+    }
+    // Number of elements or members
+    size_t size() const {
+        return block()[0];
+    }
+    // Element or member number i, invalid if out of range
+    JsonView at(size_t i) const {
+        if (i >= size())
+            return JsonView();
+        JsonValue element;
+        element.ival = block()[1 + (getTag() == JSON_OBJECT ? 2 * i : i)];
+        return JsonView(base, element);
+    }
+    // Key of member number i
+    const char *key(size_t i) const {
+        assert(getTag() == JSON_OBJECT && i < size());
+        return base + block()[2 + 2 * i];
+    }
+    // Member with given key (first one if repeated), invalid if there is none
+    JsonView find(const char *key) const;
+};
+
+// Writes position independent snapshot image of value to sink in one piece. Image is in
+// native byte order, keys and strings are NUL terminated.
+int jsonSnapshot(JsonValue value, JsonSink sink, void *context);
+// Root of image, e.g. from jsonMapFile without writable, which must stay mapped while it
+// is read. Image is checked once here, in one pass: JSON_BAD_SNAPSHOT unless it is a
+// snapshot of this size with every offset inside it and every string terminated there.
+int jsonLoadSnapshot(const char *image, size_t size, JsonView *root);
+
+// Typed decoding straight into structs, no nodes are built for their fields:
+//     struct Point { double x, y; const char *label; };
+//     JSON_SCHEMA(Point, JSON_FIELD(x), JSON_FIELD(y), JSON_FIELD_NAMED(label, "name"))
+//     Point point = {};
+//     int status = jsonDecode(begin, end, &endptr, &point, allocator);
+// Fields can be bool, int, int64_t, float, double, char * (NUL terminated in place, as
+// jsonParse strings), JsonStringView, JsonValue (any value, built as by jsonParse) or
+// struct with its own schema. Unknown keys are skipped, null leaves field as it was,
+// other value which doesn't fit the field fails with JSON_TYPE_MISMATCH. Integers are
+// parsed exactly, as with JSON_PARSE_INTEGERS.
+enum JsonFieldKind {
+    JSON_FIELD_BOOL,
+    JSON_FIELD_INT,
+    JSON_FIELD_INT64,
+    JSON_FIELD_FLOAT,
+    JSON_FIELD_DOUBLE,
+    JSON_FIELD_STRING,
+    JSON_FIELD_STRING_VIEW,
+    JSON_FIELD_VALUE,
+    JSON_FIELD_OBJECT
+};
+
+class JsonSchema;
+
+struct JsonField {
+    const char *name;
+    size_t offset;
+    JsonFieldKind kind;
+    // of JSON_FIELD_OBJECT
+    const JsonSchema *schema;
+};
+
+// Fields of struct with perfect hash of their names, built once
+class JsonSchema {
+    const JsonField *fields;
+    size_t count;
+    uint64_t multiplier;
+    int shift;
+    // field index + 1 for every hash, 0 for none; nullptr if out of memory
+    uint16_t *slots;
+
+public:
+    JsonSchema(const JsonField *fields, size_t count);
+    JsonSchema(const JsonSchema &) = delete;
+    JsonSchema &operator=(const JsonSchema &) = delete;
+    ~JsonSchema();
+    bool valid() const {
+        return slots != nullptr;
+    }
+    // Field with name of length bytes, nullptr if there is none
+    const JsonField *find(const char *name, size_t length) const;
+};
+
+// Field kind of member type, structs need their JSON_SCHEMA
+template <typename T>
+struct JsonFieldTraits {
+    static const JsonFieldKind kind = JSON_FIELD_OBJECT;
+    static const JsonSchema *schema() {
+        return &jsonSchema((const T *)nullptr);
+    }
+};
+
+#define JSON_FIELD_TRAITS(type, value)             \
+    template <>                                    \
+    struct JsonFieldTraits<type> {                 \
+        static const JsonFieldKind kind = value;   \
+        static const JsonSchema *schema() {        \
+            return nullptr;                        \
+        }                                          \
+    };
+JSON_FIELD_TRAITS(bool, JSON_FIELD_BOOL)
+JSON_FIELD_TRAITS(int, JSON_FIELD_INT)
+JSON_FIELD_TRAITS(int64_t, JSON_FIELD_INT64)
+JSON_FIELD_TRAITS(float, JSON_FIELD_FLOAT)
+JSON_FIELD_TRAITS(double, JSON_FIELD_DOUBLE)
+JSON_FIELD_TRAITS(char *, JSON_FIELD_STRING)
+JSON_FIELD_TRAITS(const char *, JSON_FIELD_STRING)
+JSON_FIELD_TRAITS(JsonStringView, JSON_FIELD_STRING_VIEW)
+JSON_FIELD_TRAITS(JsonValue, JSON_FIELD_VALUE)
+#undef JSON_FIELD_TRAITS
+
+// Defines jsonSchema(const type *) next to type, fields are JSON_FIELD or JSON_FIELD_NAMED
+#define JSON_SCHEMA(type, ...)                                                                 \
+    inline const JsonSchema &jsonSchema(const type *) {                                        \
+        typedef type JsonSchemaType;                                                           \
+        static const JsonField fields[] = {__VA_ARGS__};                                       \
+        static const JsonSchema schema(fields, sizeof(fields) / sizeof(fields[0]));            \
+        return schema;                                                                         \
+    }
+#define JSON_FIELD_NAMED(member, name)                                                         \
+    JsonField{name, offsetof(JsonSchemaType, member),                                          \
+              JsonFieldTraits<decltype(JsonSchemaType::member)>::kind,                         \
+              JsonFieldTraits<decltype(JsonSchemaType::member)>::schema()}
+#define JSON_FIELD(member) JSON_FIELD_NAMED(member, #member)
+
+// Decodes object in [begin, end) into fields of object, flags as for jsonParse
+int jsonDecode(char *begin, char *end, char **endptr, void *object, const JsonSchema &schema, JsonAllocator &allocator, int flags = 0);
+
+template <typename T>
+inline int jsonDecode(char *begin, char *end, char **endptr, T *object, JsonAllocator &allocator, int flags = 0) {
+    return jsonDecode(begin, end, endptr, object, jsonSchema((const T *)nullptr), allocator, flags);
+}
+
+// Maps file privately (copy-on-write), followed by at least JSON_PADDING zero bytes, so it
+// is NUL terminated and can be parsed in place without reading into memory first. Without
+// writable it is mapped read-only for JSON_PARSE_NONDESTRUCTIVE. Returns nullptr on error.
+char *jsonMapFile(const char *filename, size_t *size, bool writable = true);
+void jsonUnmapFile(char *source, size_t size);
@@ -10,88 +10,8 @@
 
 const int SHIFT_WIDTH = 4;
 
-void dumpString(const char *s) {
-    fputc('"', stdout);
-    while (*s) {
-        int c = *s++;
-        switch (c) {
-        case '\b':
-            fprintf(stdout, "\\b");
-            break;
-        case '\f':
-            fprintf(stdout, "\\f");
-            break;
-        case '\n':
-            fprintf(stdout, "\\n");
-            break;
-        case '\r':
-            fprintf(stdout, "\\r");
-            break;
-        case '\t':
-            fprintf(stdout, "\\t");
-            break;
-        case '\\':
-            fprintf(stdout, "\\\\");
-            break;
-        case '"':
-            fprintf(stdout, "\\\"");
-            break;
-        default:
-            fputc(c, stdout);
-        }
-    }
-    fprintf(stdout, "%s\"", s);
-}
-
-void dumpValue(JsonValue o, int indent = 0) {
-    switch (o.getTag()) {
-    case JSON_NUMBER:
-        fprintf(stdout, "%f", o.toNumber());
-        break;
-    case JSON_STRING:
-        dumpString(o.toString());
-        break;
-    case JSON_ARRAY:
-        // It is not necessary to use o.toNode() to check if an array or object
-        // is empty before iterating over its members, we do it here to allow
-        // nicer pretty printing.
-        if (!o.toNode()) {
-            fprintf(stdout, "[]");
-            break;
-        }
-        fprintf(stdout, "[\n");
-        for (auto i : o) {
-            fprintf(stdout, "%*s", indent + SHIFT_WIDTH, "");
-            dumpValue(i->value, indent + SHIFT_WIDTH);
-            fprintf(stdout, i->next ? ",\n" : "\n");
-        }
-        fprintf(stdout, "%*s]", indent, "");
-        break;
-    case JSON_OBJECT:
-        if (!o.toNode()) {
-            fprintf(stdout, "{}");
-            break;
-        }
-        fprintf(stdout, "{\n");
-        for (auto i : o) {
-            fprintf(stdout, "%*s", indent + SHIFT_WIDTH, "");
-            dumpString(i->key);
-            fprintf(stdout, ": ");
-            dumpValue(i->value, indent + SHIFT_WIDTH);
-            fprintf(stdout, i->next ? ",\n" : "\n");
-        }
-        fprintf(stdout, "%*s}", indent, "");
-        break;
-    case JSON_TRUE:
-        fprintf(stdout, "true");
-        break;
-    case JSON_FALSE:
-        fprintf(stdout, "false");
-        break;
-    case JSON_NULL:
-        fprintf(stdout, "null");
-        break;
-    }
+static bool writeStdout(const char *data, size_t size, void *) {
+    return fwrite(data, 1, size, stdout) == size;
 }
 
 void printError(const char *filename, int status, char *endptr, char *source, size_t size) {
@@ -159,34 +79,42 @@ int main(int argc, char **argv) {
     });
 #endif
 
-    FILE *fp = (argc > 1 && strcmp(argv[1], "-")) ? fopen(argv[1], "rb") : stdin;
-    if (!fp) {
-        fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    char *source = nullptr;
+    const char *filename = (argc > 1 && strcmp(argv[1], "-")) ? argv[1] : nullptr;
     size_t sourceSize = 0;
-    size_t bufferSize = 0;
-    while (!feof(fp)) {
-        if (sourceSize + 1 >= bufferSize) {
-            bufferSize = bufferSize < BUFSIZ ? BUFSIZ : bufferSize * 2;
-            source = (char *)realloc(source, bufferSize);
+    // regular files are mapped copy-on-write and parsed in place, anything else is read
+    char *source = filename ? jsonMapFile(filename, &sourceSize) : nullptr;
+    if (!source) {
+        FILE *fp = filename ? fopen(filename, "rb") : stdin;
+        if (!fp) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], filename, strerror(errno));
+            exit(EXIT_FAILURE);
         }
-        sourceSize += fread(source + sourceSize, 1, bufferSize - sourceSize - 1, fp);
+        size_t bufferSize = 0;
+        while (!feof(fp)) {
+            if (sourceSize + 1 >= bufferSize) {
+                bufferSize = bufferSize < BUFSIZ ? BUFSIZ : bufferSize * 2;
+                source = (char *)realloc(source, bufferSize);
+            }
+            sourceSize += fread(source + sourceSize, 1, bufferSize - sourceSize - 1, fp);
+        }
+        fclose(fp);
+        source[sourceSize] = 0;
     }
-    fclose(fp);
-    source[sourceSize] = 0;
 
     char *endptr;
     JsonValue value;
     JsonAllocator allocator;
-    int status = jsonParse(source, &endptr, &value, allocator);
+    allocator.reserve(sourceSize / 2);
+    int status = jsonParse(source, &endptr, &value, allocator, JSON_PARSE_INTEGERS);
     if (status != JSON_OK) {
-        printError((argc > 1 && strcmp(argv[1], "-")) ? argv[1] : "-stdin-", status, endptr, source, sourceSize);
+        printError(filename ? filename : "-stdin-", status, endptr, source, sourceSize);
+        exit(EXIT_FAILURE);
+    }
+    JsonWriter writer(writeStdout, nullptr, SHIFT_WIDTH);
+    if (writer.write(value) != JSON_OK || writer.flush() != JSON_OK || fputc('\n', stdout) == EOF) {
+        fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
         exit(EXIT_FAILURE);
     }
-    dumpValue(value);
-    fprintf(stdout, "\n");
 
     return 0;
 }
@@ -2,16 +2,21 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <locale.h>
 
 static int parsed;
 static int failed;
 
-void parse(const char *csource, bool ok) {
-    char *source = strdup(csource);
+// fuzz.cpp: all parse modes agree with bounded jsonParse on these bytes
+bool differential(const char *data, size_t size);
+
+void parse(const char *csource, bool ok, int flags) {
+    // string literals are read-only, so nondestructive parse gets them as is
+    char *source = (flags & JSON_PARSE_NONDESTRUCTIVE) ? (char *)csource : strdup(csource);
     char *endptr;
     JsonValue value;
     JsonAllocator allocator;
-    int result = jsonParse(source, &endptr, &value, allocator);
+    int result = jsonParse(source, &endptr, &value, allocator, flags);
     if (ok && result) {
         fprintf(stderr, "FAILED %d: %s\n%s\n%*s - \\x%02X\n", parsed, jsonStrError(result), csource, (int)(endptr - source + 1), "^", *endptr);
         ++failed;
@@ -21,9 +26,1016 @@ void parse(const char *csource, bool ok) {
         ++failed;
     }
     ++parsed;
+    if (source != csource)
+        free(source);
+}
+
+// Source is copied without terminator, so reading past the end is caught by sanitizers.
+// Padded slack is filled with digits, so missing terminator breaks trailing numbers.
+void bounded(const char *csource, size_t size, bool ok, int flags) {
+    size_t slack = (flags & JSON_PARSE_PADDED) ? JSON_PADDING : 0;
+    char *source = (char *)malloc(size + slack + 1);
+    memcpy(source, csource, size);
+    memset(source + size, '7', slack);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse(source, source + size, &endptr, &value, allocator, flags);
+    if (ok && result) {
+        fprintf(stderr, "FAILED %d: %s (bounded)\n%s\n", parsed, jsonStrError(result), csource);
+        ++failed;
+    }
+    if (!ok && !result) {
+        fprintf(stderr, "PASSED %d: (bounded)\n%s\n", parsed, csource);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+void bounded(const char *csource, bool ok, int flags) {
+    bounded(csource, strlen(csource), ok, flags);
+}
+
+// Source without terminator must come out intact, with the status and position of jsonParse
+void validate(const char *csource, size_t size, bool ok, int flags) {
+    char *source = (char *)malloc(size);
+    memcpy(source, csource, size);
+    const char *endptr;
+    int result = jsonValidate(source, source + size, &endptr, flags);
+    char *parseEnd;
+    JsonValue value;
+    JsonAllocator allocator;
+    int expected = jsonParse(source, source + size, &parseEnd, &value, allocator, flags | JSON_PARSE_NONDESTRUCTIVE);
+    if (ok != !result || result != expected || endptr != parseEnd || memcmp(source, csource, size)) {
+        fprintf(stderr, "FAILED %d: %s (validate)\n%s\n", parsed, jsonStrError(result), csource);
+        ++failed;
+    }
+    ++parsed;
     free(source);
 }
 
+void validate(const char *csource, bool ok, int flags) {
+    validate(csource, strlen(csource), ok, flags);
+}
+
+// Feeds source in chunks of given size, so every token gets split somewhere.
+void stream(const char *csource, bool ok, size_t chunk) {
+    char *source = strdup(csource);
+    size_t size = strlen(source);
+    JsonValue value;
+    JsonAllocator allocator;
+    JsonStreamParser parser(allocator);
+    int result = JSON_OK;
+    for (size_t i = 0; i < size && !result; i += chunk)
+        result = parser.feed(source + i, i + chunk < size ? chunk : size - i);
+    if (!result)
+        result = parser.finish(&value);
+    if (ok && result) {
+        fprintf(stderr, "FAILED %d: %s at %zu (stream by %zu)\n%s\n", parsed, jsonStrError(result), parser.position(), chunk, csource);
+        ++failed;
+    }
+    if (!ok && !result) {
+        fprintf(stderr, "PASSED %d: (stream by %zu)\n%s\n", parsed, chunk, csource);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+void parse(const char *csource, bool ok) {
+    parse(csource, ok, 0);
+    parse(csource, ok, JSON_PARSE_INDEXED);
+    parse(csource, ok, JSON_PARSE_NONDESTRUCTIVE);
+    parse(csource, ok, JSON_PARSE_CONTIGUOUS | JSON_PARSE_INTERN_KEYS);
+    bounded(csource, ok, 0);
+    bounded(csource, ok, JSON_PARSE_INDEXED);
+    bounded(csource, ok, JSON_PARSE_PADDED);
+    validate(csource, ok, 0);
+    validate(csource, ok, JSON_PARSE_INDEXED);
+    stream(csource, ok, 1);
+    stream(csource, ok, 7);
+    if (!differential(csource, strlen(csource))) {
+        fprintf(stderr, "FAILED %d: differential\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+}
+
+// Terminator ends top-level string of NUL terminated source, bounded and padded source
+// have none, so there it is unterminated
+void terminator() {
+    const char *csource = u8R"json("Unterminated top-level string)json";
+    parse(csource, true, 0);
+    parse(csource, true, JSON_PARSE_INDEXED);
+    bounded(csource, false, 0);
+    bounded(csource, false, JSON_PARSE_INDEXED);
+    bounded(csource, false, JSON_PARSE_PADDED);
+    bounded(csource, false, JSON_PARSE_PADDED | JSON_PARSE_INDEXED);
+    validate(csource, false, 0);
+}
+
+// NUL inside bounded source is a byte like any other, every mode rejects it right there
+template <size_t N>
+void embedded(const char (&csource)[N]) {
+    bounded(csource, N - 1, false, 0);
+    bounded(csource, N - 1, false, JSON_PARSE_INDEXED);
+    bounded(csource, N - 1, false, JSON_PARSE_PADDED);
+    bounded(csource, N - 1, false, JSON_PARSE_PADDED | JSON_PARSE_INDEXED);
+    bounded(csource, N - 1, false, JSON_PARSE_NONDESTRUCTIVE);
+    validate(csource, N - 1, false, 0);
+    validate(csource, N - 1, false, JSON_PARSE_INDEXED);
+    if (!differential(csource, N - 1)) {
+        fprintf(stderr, "FAILED %d: differential\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+}
+
+void nondestructive() {
+    const char *source = u8R"json({"key": "escaped \"string\" \u0041"})json";
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse((char *)source, &endptr, &value, allocator, JSON_PARSE_NONDESTRUCTIVE);
+    if (result || strcmp(value.toNode()->key, "key") || strcmp(value.toNode()->value.toString(), "escaped \"string\" A")) {
+        fprintf(stderr, "FAILED %d: nondestructive\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+}
+
+void streaming() {
+    const char *source = u8R"json({"key": ["split \"string\"", 12345, true]})json";
+    char chunk[3];
+    JsonValue value;
+    JsonAllocator allocator;
+    JsonStreamParser parser(allocator, JSON_PARSE_NONDESTRUCTIVE);
+    // chunk buffer is reused, so values must not point into it
+    for (size_t i = 0, size = strlen(source); i < size; i += sizeof(chunk)) {
+        size_t n = i + sizeof(chunk) < size ? sizeof(chunk) : size - i;
+        memcpy(chunk, source + i, n);
+        parser.feed(chunk, n);
+        memset(chunk, '"', sizeof(chunk));
+    }
+    int result = parser.finish(&value);
+    JsonNode *array = result ? nullptr : value.toNode()->value.toNode();
+    if (result || strcmp(value.toNode()->key, "key") || strcmp(array->value.toString(), "split \"string\"") ||
+        array->next->value.toNumber() != 12345 || array->next->next->value.getTag() != JSON_TRUE) {
+        fprintf(stderr, "FAILED %d: streaming\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+}
+
+void documents(int flags, size_t expected, const int *statuses) {
+    char source[] = "{\"a\": 1}\n[1, 2]\r\n\n{\"a\": 1\n{\"b\": 2}\n\"x\" 3\n  \n";
+    JsonDocument *documents;
+    size_t count;
+    JsonAllocator allocator;
+    int result = jsonParseDocuments(source, source + sizeof(source) - 1, &documents, &count, allocator, flags);
+    bool ok = !result && count == expected;
+    for (size_t i = 0; ok && i < count; ++i)
+        ok = documents[i].status == statuses[i];
+    if (ok && documents[0].status == JSON_OK)
+        ok = documents[0].value.toNode()->value.toNumber() == 1;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: documents %d\n", parsed, flags);
+        ++failed;
+    }
+    ++parsed;
+}
+
+// Lines are long enough for several chunks, one of them longer than a chunk.
+void parallel() {
+    size_t size = 0, lines = 40000;
+    char *source = (char *)malloc(lines * 64 + (128 << 10));
+    for (size_t i = 0; i < lines; ++i) {
+        if (i == lines / 2) {
+            source[size++] = '"';
+            memset(source + size, 'x', 100 << 10);
+            size += 100 << 10;
+            size += sprintf(source + size, "\"\n");
+        }
+        size += sprintf(source + size, i % 97 ? "{\"line\": %zu, \"values\": [1, 2, 3]}\n" : "{\"line\": %zu, bad}\n", i);
+    }
+    char *copy = (char *)malloc(size);
+    memcpy(copy, source, size);
+
+    JsonDocument *expected, *documents;
+    size_t expectedCount, count;
+    JsonAllocator allocator;
+    JsonParallelParser parser(4);
+    int result = jsonParseDocuments(source, source + size, &expected, &expectedCount, allocator, JSON_PARSE_LINES);
+    result |= parser.parse(copy, copy + size, &documents, &count);
+    bool ok = !result && count == expectedCount && count == lines + 1;
+    for (size_t i = 0; ok && i < count; ++i) {
+        ok = documents[i].status == expected[i].status && documents[i].begin - copy == expected[i].begin - source;
+        if (ok && !documents[i].status && documents[i].value.getTag() == JSON_OBJECT)
+            ok = documents[i].value.toNode()->value.toNumber() == expected[i].value.toNode()->value.toNumber();
+    }
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: parallel\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+    free(copy);
+}
+
+static bool equal(JsonValue a, JsonValue b) {
+    if (a.getTag() != b.getTag())
+        return false;
+    switch (a.getTag()) {
+    case JSON_NUMBER:
+        return a.toNumber() == b.toNumber();
+    case JSON_INTEGER:
+        return a.toInteger() == b.toInteger();
+    case JSON_STRING:
+        return !strcmp(a.toString(), b.toString());
+    case JSON_ARRAY:
+    case JSON_OBJECT: {
+        JsonNode *i = a.toNode(), *j = b.toNode();
+        for (; i && j; i = i->next, j = j->next)
+            if (!equal(i->value, j->value) || (a.getTag() == JSON_OBJECT && strcmp(i->key, j->key)))
+                return false;
+        return !i && !j;
+    }
+    default:
+        return true;
+    }
+}
+
+void contiguous() {
+    const char *source = u8R"json({"a": [1, [], {"b": 2, "c": [3, 4, 5]}], "d": {}})json";
+    char *endptr;
+    JsonValue expected, value;
+    JsonAllocator allocator;
+    int result = jsonParse((char *)source, &endptr, &expected, allocator, JSON_PARSE_NONDESTRUCTIVE);
+    result |= jsonParse((char *)source, &endptr, &value, allocator, JSON_PARSE_NONDESTRUCTIVE | JSON_PARSE_CONTIGUOUS);
+    bool ok = !result && equal(value, expected) && value.isContiguous() && !expected.isContiguous() && value.size() == 2;
+    if (ok) {
+        JsonValue a = value.at(0)->value;
+        JsonValue c = a.at(2)->value.at(1)->value;
+        ok = a.size() == 3 && a.at(3) == nullptr && a.at(1)->value.size() == 0 && !strcmp(value.at(1)->key, "d") &&
+             c.size() == 3 && c.at(2)->value.toNumber() == 5 && expected.at(0)->value.at(2)->value.size() == 2;
+    }
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: contiguous\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+}
+
+// Keys repeat every 500, so both list and hash lookups must find the first one.
+void find(int flags) {
+    size_t size = 0, members = 1000;
+    char *source = (char *)malloc(members * 32);
+    source[size++] = '{';
+    for (size_t i = 0; i < members; ++i)
+        size += sprintf(source + size, "\"key%zu\": %zu, ", i % 500, i);
+    size += sprintf(source + size, "\"small\": {\"a\": 1, \"b\": 2}}");
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse(source, &endptr, &value, allocator, flags);
+    bool ok = !result;
+    for (size_t i = 0; ok && i < 500; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%zu", i);
+        JsonNode *node = jsonFind(value, key, allocator);
+        ok = node && node->value.toNumber() == i && node == jsonFind(value, key);
+    }
+    if (ok) {
+        JsonValue small = jsonFind(value, "small", allocator)->value;
+        ok = !jsonFind(value, "key500", allocator) && !jsonFind(value, "", allocator) && jsonFind(small, "b", allocator)->value.toNumber() == 2 && !jsonFind(small, "c");
+    }
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: find %d\n", parsed, flags);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+void intern(int flags) {
+    char source[] = u8R"json([{"id": 1, "n\u0061me": "a"}, {"id": 2, "name": "b", "key": {"id": 3}}])json";
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse(source, &endptr, &value, allocator, flags | JSON_PARSE_INTERN_KEYS);
+    char *id = allocator.intern("id");
+    char *name = allocator.intern("name", 4);
+    JsonNode *a = result ? nullptr : value.toNode()->value.toNode();
+    JsonNode *b = result ? nullptr : value.toNode()->next->value.toNode();
+    bool ok = !result && a->key == id && b->key == id && a->next->key == name && b->next->key == name &&
+              b->next->next->value.toNode()->key == id && id != name && !strcmp(name, "name");
+    allocator.reset();
+    ok = ok && !strcmp(allocator.intern("id"), "id");
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: intern %d\n", parsed, flags);
+        ++failed;
+    }
+    ++parsed;
+}
+
+void lazy() {
+    const char *csource = u8R"json({"skip": [{"]": "}\"]"}, [[[]]], "\\"], "n\u0061me": "x\ty", "list": [1, true, {"a": null}], "last": -2.5e1} tail)json";
+    size_t size = strlen(csource);
+    char *source = (char *)malloc(size);
+    memcpy(source, csource, size);
+    JsonLazy root(source, source + size);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    JsonLazy list = root.find("list");
+    bool ok = root.getTag() == JSON_OBJECT && list.getTag() == JSON_ARRAY && list.at(2).find("a").getTag() == JSON_NULL &&
+              !list.at(3).valid() && !root.find("a").valid() && !root.find("skip").find("]").valid() &&
+              root.find("skip").at(0).find("]").parse(&endptr, &value, allocator) == JSON_OK && !strcmp(value.toString(), "}\"]") &&
+              root.find("name").parse(&endptr, &value, allocator) == JSON_OK && !strcmp(value.toString(), "x\ty") &&
+              root.find("last").parse(&endptr, &value, allocator) == JSON_OK && value.toNumber() == -25 && *endptr == '}';
+    size_t members = 0;
+    for (JsonLazy i = root.first(); ok && i.valid(); i = i.next())
+        ok = i.key().getTag() == JSON_STRING && ++members;
+    ok = ok && members == 4 && !memcmp(source, csource, size);
+    JsonLazy truncated(source, source + 20);
+    ok = ok && truncated.find("skip").valid() && !truncated.find("name").valid() && !truncated.find("skip").next().valid();
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: lazy\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+struct Extracted {
+    char text[256];
+    size_t size;
+};
+
+static void extracted(size_t path, JsonValue value, void *context) {
+    Extracted *e = (Extracted *)context;
+    e->size += snprintf(e->text + e->size, sizeof(e->text) - e->size, "%zu:%s ", path,
+                        value.getTag() == JSON_STRING ? value.toString() : value.getTag() == JSON_NUMBER ? "number" : value.getTag() == JSON_OBJECT ? "object" : "other");
+}
+
+// Wildcard and duplicate paths all match, bad tail after the last match is never seen,
+// but the root path parses it all
+void query() {
+    const char *paths[] = {"/user/id", "/items/*/price", "/items/1", "/a~1b~0", "/items/7/x", "/items/1", "/items/01", ""};
+    const char *csource = u8R"json({"items": [{"price": 1, "x": [{"price": 0}]}, {"price": "two"}, {"name": "}"}], "a/b~": "slash", "user": {"name": {}, "id": "u1", "more": [} ])json";
+    size_t size = strlen(csource);
+    char *source = (char *)malloc(size);
+    memcpy(source, csource, size);
+    JsonQuery q;
+    JsonAllocator allocator;
+    char *endptr;
+    Extracted e = {{}, 0};
+    bool ok = q.compile(paths, 7) == JSON_OK &&
+              q.extract(source, source + size, &endptr, extracted, &e, allocator) == JSON_OK &&
+              endptr - source == strstr(csource, "\"u1\"") + 4 - csource &&
+              !strcmp(e.text, "1:number 1:two 2:object 5:object 3:slash 0:u1 ") && !memcmp(source, csource, size);
+    // wildcard walks the array through, to its closing bracket
+    const char *all[] = {"/items/*/price"};
+    char whole[] = u8R"json({"items": [{"price": 1}, {"price": 2}], "rest": [})json";
+    e.size = 0;
+    ok = ok && q.compile(all, 1) == JSON_OK &&
+         q.extract(whole, whole + strlen(whole), &endptr, extracted, &e, allocator) == JSON_OK && endptr == strchr(whole, ']') + 1 &&
+         !strcmp(e.text, "0:number 0:number ");
+    e.size = 0;
+    ok = ok && q.compile(paths + 7, 1) == JSON_OK &&
+         q.extract(source, source + size, &endptr, extracted, &e, allocator) == JSON_MISMATCH_BRACKET && *endptr == '}' && !e.size;
+    const char *bad[] = {"/ok", "x"}, *escape[] = {"/a~2"};
+    ok = ok && q.compile(bad, 2) == JSON_BAD_POINTER && q.compile(escape, 1) == JSON_BAD_POINTER && !strcmp(jsonStrError(JSON_BAD_POINTER), "bad pointer");
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: query %s\n", parsed, e.text);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+struct Trace : JsonSaxHandler {
+    char text[256];
+    size_t size;
+    double sum;
+    size_t events;
+
+    void add(const char *s, size_t length) {
+        if (size + length < sizeof(text)) {
+            memcpy(text + size, s, length);
+            text[size += length] = 0;
+        }
+        ++events;
+    }
+    void onNull() {
+        add("n", 1);
+    }
+    void onBool(bool b) {
+        add(b ? "t" : "f", 1);
+    }
+    // big number is only seen, sum of the rest is exact
+    void onNumber(double x) {
+        sum += x < 1e9 ? x : 0;
+        add("#", 1);
+    }
+    void onInteger(int64_t x) {
+        sum += x < 1000000000 ? x : 0;
+        add("i", 1);
+    }
+    void onString(char *s, size_t length) {
+        add(s, length);
+    }
+    void onKey(char *s, size_t length) {
+        add(s, length);
+        add(":", 1);
+    }
+    void onStartArray() {
+        add("[", 1);
+    }
+    void onEndArray() {
+        add("]", 1);
+    }
+    void onStartObject() {
+        add("{", 1);
+    }
+    // onEndObject from JsonSaxHandler
+};
+
+// Events many times the window, so parse resumes between windows; errors are jsonParse ones
+void sax(int flags) {
+    char *source = (char *)malloc(100000);
+    size_t size = sprintf(source, u8R"json({"ab": [1, "x\ty", true, false, null, {}], "c": 9007199254740993, "long": [)json");
+    for (int i = 0; i < 5000; ++i)
+        size += sprintf(source + size, "%d, ", i);
+    size += sprintf(source + size, "-1.5]} tail");
+    char *copy = (char *)malloc(size);
+    memcpy(copy, source, size);
+    char *endptr;
+    JsonSaxParser parser;
+    JsonAllocator allocator;
+    Trace trace;
+    trace.size = 0;
+    trace.text[0] = 0;
+    trace.sum = 0;
+    trace.events = 0;
+    const char *expected = flags & JSON_PARSE_INTEGERS ? "{ab:[ix\tytfn{]c:ilong:[" : "{ab:[#x\tytfn{]c:#long:[";
+    bool ok = parser.parse(source, source + size, &endptr, trace, allocator, flags) == JSON_OK && !memcmp(endptr, " tail", 5) &&
+              !strncmp(trace.text, expected, strlen(expected)) && trace.events == 5019 &&
+              trace.sum == 1 + 4999 * 5000 / 2 - 1.5;
+
+    JsonValue value;
+    char *expectedEnd;
+    copy[size - 7] = ',';
+    size_t events = trace.events;
+    int expectedResult = jsonParse(copy, copy + size, &expectedEnd, &value, allocator, flags | JSON_PARSE_NONDESTRUCTIVE);
+    memcpy(source, copy, size);
+    ok = ok && parser.parse(source, source + size, &endptr, trace, allocator, flags) == expectedResult && expectedResult == JSON_MISMATCH_BRACKET &&
+         endptr - source == expectedEnd - copy && trace.events == events * 2 - 1;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: sax %s\n", parsed, trace.text);
+        ++failed;
+    }
+    ++parsed;
+    free(copy);
+    free(source);
+}
+
+struct Chunks {
+    char text[4096];
+    size_t size;
+    size_t calls;
+    size_t fail;
+};
+
+static bool chunk(const char *data, size_t size, void *context) {
+    Chunks *c = (Chunks *)context;
+    if (++c->calls == c->fail || c->size + size > sizeof(c->text))
+        return false;
+    memcpy(c->text + c->size, data, size);
+    c->size += size;
+    return true;
+}
+
+// Written document parses back to the same values, indented one looks like gasonpp output
+void writer(int flags) {
+    const char *csource = u8R"json({"a": [1, -0.0, 0.1, 1e300, 2.5e-310, 123e-20, 100, -7, "q\"\\\/\b\f\n\r\t\u0001\u007Fа ok"],
+                                    "b": {"": [], "e": {}, "n": null, "t": true, "f": false}, "big": 9223372036854775807})json";
+    char *source = strdup(csource);
+    char *endptr;
+    JsonValue value, copy;
+    JsonAllocator allocator, copies;
+    bool ok = jsonParse(source, &endptr, &value, allocator, flags) == JSON_OK;
+    JsonWriter compact;
+    ok = ok && compact.write(value) == JSON_OK;
+    char *written = (char *)malloc(compact.length() + 1);
+    memcpy(written, compact.data(), compact.length());
+    written[compact.length()] = 0;
+    ok = ok && jsonParse(written, &endptr, &copy, copies, flags) == JSON_OK && equal(value, copy);
+
+    Chunks chunks = {{}, 0, 0, 0};
+    JsonWriter indented(chunk, &chunks, 2);
+    ok = ok && indented.write(value.toNode()->next->value) == JSON_OK && indented.flush() == JSON_OK && chunks.calls == 1;
+    const char *expected = "{\n  \"\": [],\n  \"e\": {},\n  \"n\": null,\n  \"t\": true,\n  \"f\": false\n}";
+    ok = ok && chunks.size == strlen(expected) && !memcmp(chunks.text, expected, chunks.size);
+
+    // output past JSON_WRITER_BUFFER goes to sink before flush, its failure sticks
+    JsonValue long_string(JSON_STRING, (void *)strdup("%"));
+    char *big = (char *)malloc(JSON_WRITER_BUFFER + 1);
+    memset(big, 'x', JSON_WRITER_BUFFER);
+    big[JSON_WRITER_BUFFER] = 0;
+    chunks = {{}, 0, 0, 1};
+    JsonWriter failing(chunk, &chunks);
+    ok = ok && failing.write(long_string) == JSON_OK && failing.write(JsonValue(JSON_STRING, big)) == JSON_WRITE_FAILURE && failing.flush() == JSON_WRITE_FAILURE && chunks.calls == 1;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: writer %.*s\n", parsed, (int)compact.length(), compact.data());
+        ++failed;
+    }
+    ++parsed;
+    free(long_string.toString());
+    free(big);
+    free(written);
+    free(source);
+}
+
+// Subnormals take the same digit code as other doubles, so locale never shows in output
+void doubles() {
+    const double values[] = {4.9406564584124654e-324, 1.5e-310, 2.225073858507201e-308, 2.2250738585072014e-308, 1.7976931348623157e308};
+    const char *expected = "[5e-324,1.5e-310,2.225073858507201e-308,2.2250738585072014e-308,1.7976931348623157e308]";
+    const char *previous = setlocale(LC_NUMERIC, nullptr);
+    char *saved = previous ? strdup(previous) : nullptr;
+    // comma is decimal separator there, if the system has it
+    setlocale(LC_NUMERIC, "de_DE.UTF-8");
+    JsonAllocator allocator;
+    JsonBuilder array(JSON_ARRAY);
+    bool ok = true;
+    for (double x : values)
+        ok = ok && array.append(JsonValue(x), allocator);
+    JsonWriter writer;
+    ok = ok && writer.write(array.value) == JSON_OK && writer.length() == strlen(expected) && !memcmp(writer.data(), expected, writer.length());
+    if (saved)
+        setlocale(LC_NUMERIC, saved);
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: doubles %.*s\n", parsed, (int)writer.length(), writer.data());
+        ++failed;
+    }
+    ++parsed;
+    free(saved);
+}
+
+static bool equal(JsonView view, JsonValue value) {
+    if (view.getTag() != value.getTag())
+        return false;
+    switch (value.getTag()) {
+    case JSON_NUMBER:
+        return view.toNumber() == value.toNumber();
+    case JSON_INTEGER:
+        return view.toInteger() == value.toInteger();
+    case JSON_STRING:
+        return !strcmp(view.toString(), value.toString());
+    case JSON_ARRAY:
+    case JSON_OBJECT: {
+        size_t i = 0;
+        for (auto node : value) {
+            if (!view.at(i).valid() || !equal(view.at(i), node->value) || (value.getTag() == JSON_OBJECT && strcmp(view.key(i), node->key)))
+                return false;
+            ++i;
+        }
+        return i == view.size();
+    }
+    default:
+        return true;
+    }
+}
+
+static bool writeFile(const char *data, size_t size, void *context) {
+    return fwrite(data, 1, size, (FILE *)context) == size;
+}
+
+// Image read back from mapped file has the same values, without parsing and in place
+void snapshot(int flags) {
+    const char *csource = u8R"json({"a": [0, 0.0, -1.5, 9223372036854775807, -7, "x\ty", [], {}], "empty": "", "t": true, "f": false, "n": null, "a": 2})json";
+    char *source = strdup(csource);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    const char *filename = "test-suite.snapshot";
+    FILE *fp = fopen(filename, "wb");
+    bool ok = jsonParse(source, &endptr, &value, allocator, flags) == JSON_OK && fp && jsonSnapshot(value, writeFile, fp) == JSON_OK;
+    if (fp)
+        fclose(fp);
+    size_t size = 0;
+    char *image = ok ? jsonMapFile(filename, &size, false) : nullptr;
+    JsonView root, bad;
+    ok = ok && image && jsonLoadSnapshot(image, size, &root) == JSON_OK && equal(root, value) && root.find("a").getTag() == JSON_ARRAY &&
+         (!(flags & JSON_PARSE_INTEGERS) || root.find("a").at(3).toInteger() == INT64_MAX) && !root.find("a").at(8).valid() &&
+         !root.find("b").valid() && jsonLoadSnapshot(image, size - 8, &bad) == JSON_BAD_SNAPSHOT && jsonLoadSnapshot(csource, 24, &bad) == JSON_BAD_SNAPSHOT;
+    // offsets are checked at load: root count past the end, first member pointing back at
+    // the root block, last key without terminator
+    char *corrupt = ok ? (char *)malloc(size) : nullptr;
+    for (int i = 0; corrupt && i < 3; ++i) {
+        memcpy(corrupt, image, size);
+        uint64_t *words = (uint64_t *)corrupt;
+        if (i == 0)
+            words[4] = UINT64_MAX / 2;
+        else if (i == 1)
+            words[5] = JsonValue(JSON_ARRAY, (void *)32).ival;
+        else
+            memset(corrupt + size - 8, 'x', 8);
+        ok = ok && jsonLoadSnapshot(corrupt, size, &bad) == JSON_BAD_SNAPSHOT && !bad.valid();
+    }
+    free(corrupt);
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: snapshot\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    if (image)
+        jsonUnmapFile(image, size);
+    remove(filename);
+    free(source);
+}
+
+// Copy outlives source and allocator of the original, and is contiguous whatever it was
+void clone(int flags) {
+    const char *csource = u8R"json({"a": [0, -1.5, 9223372036854775807, -7, "x\ty", [], {}], "empty": "", "o": {"t": true, "n": null}})json";
+    char *source = strdup(csource);
+    char *endptr;
+    JsonValue expected, value, copy, scalar;
+    JsonAllocator allocator, expectedAllocator, copyAllocator;
+    int result = jsonParse((char *)csource, &endptr, &expected, expectedAllocator, flags | JSON_PARSE_NONDESTRUCTIVE);
+    result |= jsonParse(source, &endptr, &value, allocator, flags);
+    result |= jsonClone(value, &copy, copyAllocator);
+    result |= jsonClone(value.at(0)->value.at(1)->value, &scalar, copyAllocator);
+    memset(source, 0, strlen(csource));
+    free(source);
+    allocator.deallocate();
+    bool ok = !result && equal(copy, expected) && copy.isContiguous() && copy.at(0)->value.isContiguous() &&
+              copy.at(0)->value.at(5)->value.size() == 0 && scalar.toNumber() == -1.5 &&
+              jsonFind(copy, "o", copyAllocator)->value.getTag() == JSON_OBJECT && copy.at(2)->value.at(1)->next == nullptr;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: clone\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+}
+
+// Lengths come from the parser, so embedded NUL survives in strings and keys
+void lengths(int flags) {
+    const char *csource = u8R"json({"a\u0000b": ["x\u0000y", "", "\u00e9t\u00e9"], "plain": "abc"})json";
+    char *source = strdup(csource);
+    char *endptr;
+    JsonValue value, copy;
+    JsonAllocator allocator, copyAllocator;
+    int result = jsonParse(source, source + strlen(source), &endptr, &value, allocator, flags | JSON_PARSE_STRING_LENGTHS);
+    result |= jsonClone(value, &copy, copyAllocator, JSON_PARSE_STRING_LENGTHS);
+    // written whole with NUL escaped, and parsed back to the same strings
+    JsonWriter writer;
+    const char *expected = "{\"a\\u0000b\":[\"x\\u0000y\",\"\",\"\xC3\xA9t\xC3\xA9\"],\"plain\":\"abc\"}";
+    JsonValue written;
+    JsonAllocator writtenAllocator;
+    result |= writer.write(value, JSON_PARSE_STRING_LENGTHS);
+    char *output = strndup(writer.data(), writer.length());
+    bool ok = !result && !strcmp(output, expected) &&
+              jsonParse(output, output + strlen(output), &endptr, &written, writtenAllocator, flags | JSON_PARSE_STRING_LENGTHS) == JSON_OK;
+    JsonValue values[] = {value, copy, written};
+    for (int i = 0; ok && i < 3; ++i) {
+        JsonNode *a = values[i].toNode();
+        JsonStringView x = a->value.toNode()->value.toStringView();
+        JsonStringView e = a->value.toNode()->next->value.toStringView();
+        JsonStringView t = a->value.toNode()->next->next->value.toStringView();
+        ok = a->keyView().length == 3 && !memcmp(a->keyView().data, "a\0b", 4) && x.length == 3 && !memcmp(x.data, "x\0y", 4) &&
+             e.length == 0 && t.length == 5 && !strcmp(t.data, "\xC3\xA9t\xC3\xA9") &&
+             a->next->keyView().length == 5 && a->next->value.toStringView().length == 3;
+    }
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: lengths\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    free(output);
+    free(source);
+}
+
+// Patched tree written back, contiguous containers turn into lists as they change
+void mutation(int flags) {
+    char *source = strdup(u8R"json({"keep": 1, "drop": ["x", "y", "z"], "list": [], "set": "old"})json");
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    bool ok = jsonParse(source, &endptr, &value, allocator, flags) == JSON_OK;
+    JsonValue array(JSON_ARRAY), object(JSON_OBJECT);
+    ok = ok && jsonAppend(&array, jsonMakeInteger(INT64_MIN, allocator), allocator) && jsonAppend(&array, JsonValue(JSON_TRUE), allocator) &&
+         jsonInsert(&object, "s", jsonMakeString("ab!", 2, allocator), allocator) && jsonInsert(&object, "s", JsonValue(), allocator);
+    JsonNode *drop = ok ? jsonFind(value, "drop") : nullptr;
+    ok = ok && drop && jsonRemove(&drop->value, drop->value.at(0)) && jsonRemove(&drop->value, drop->value.at(1)) &&
+         !jsonRemove(&drop->value, drop->value.at(0)->next) && drop->value.size() == 1 && !drop->value.isContiguous() &&
+         jsonSet(&value, "set", array, allocator) && jsonSet(&value, "new", object, allocator) &&
+         jsonAppend(&jsonFind(value, "list")->value, JsonValue(JSON_NULL), allocator) && jsonRemove(&value, value.toNode()) &&
+         value.size() == 4 && jsonFind(jsonFind(value, "new")->value, "s")->keyView().length == 1;
+    JsonWriter writer;
+    ok = ok && writer.write(value) == JSON_OK;
+    const char *expected = "{\"drop\":[\"y\"],\"list\":[null],\"set\":[-9223372036854775808,true],\"new\":{\"s\":\"ab\",\"s\":null}}";
+    ok = ok && writer.length() == strlen(expected) && !memcmp(writer.data(), expected, writer.length());
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: mutation %.*s\n", parsed, (int)writer.length(), writer.data());
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+// Thousands of elements and members appended in constant time each, to parsed array too
+void building(int flags) {
+    char *source = strdup("[0, 1, 2]");
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    bool ok = jsonParse(source, &endptr, &value, allocator, flags | JSON_PARSE_INTEGERS) == JSON_OK;
+    JsonBuilder array(value);
+    for (int i = 3; ok && i < 50000; ++i)
+        ok = array.append(jsonMakeInteger(i, allocator), allocator) != nullptr;
+    JsonBuilder object(JSON_OBJECT);
+    char key[16];
+    for (int i = 0; ok && i < 20000; ++i) {
+        snprintf(key, sizeof(key), "k%d", i);
+        ok = object.insert(key, JsonValue(i), allocator) != nullptr;
+    }
+    int64_t expected = 0;
+    for (auto i : array.value)
+        ok = ok && i->value.toInteger() == expected++;
+    ok = ok && expected == 50000 && !array.value.isContiguous() && object.value.size() == 20000 &&
+         jsonFind(object.value, "k19999")->value.toNumber() == 19999 && jsonAppend(&array.value, JsonValue(JSON_NULL), allocator) &&
+         array.value.size() == 50001;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: building\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+struct Address {
+    const char *city;
+    int zip;
+};
+JSON_SCHEMA(Address, JSON_FIELD(city), JSON_FIELD(zip))
+
+struct Person {
+    JsonStringView name;
+    int64_t id;
+    double score;
+    float ratio;
+    bool active;
+    int age;
+    Address address;
+    JsonValue tags;
+};
+JSON_SCHEMA(Person, JSON_FIELD(name), JSON_FIELD(id), JSON_FIELD(score), JSON_FIELD(ratio), JSON_FIELD(active),
+            JSON_FIELD_NAMED(age, "years"), JSON_FIELD(address), JSON_FIELD(tags))
+
+static int decode(const char *csource, Person *person, int flags) {
+    char *source = strdup(csource);
+    char *endptr;
+    JsonAllocator allocator;
+    int status = jsonDecode(source, source + strlen(source), &endptr, person, allocator, flags);
+    // only decoded numbers are compared after return, strings die with source
+    free(source);
+    return status;
+}
+
+// Fields are filled off the tokens, unknown members of any shape are skipped
+void decoding(int flags) {
+    const char *csource = u8R"json({"name": "Ann \u0000 Lee", "skip": {"id": 5, "a": [[], {"x": 1}]}, "id": 9007199254740993,
+        "score": 3, "ratio": 0.5, "active": true, "years": 41, "address": {"zip": 10001, "city": "NYC", "extra": [1]},
+        "tags": ["a", {"b": null}], "age": "unknown", "id2": 1})json";
+    char *source = strdup(csource);
+    char *endptr;
+    JsonAllocator allocator;
+    Person person = {};
+    person.address.zip = -1;
+    bool ok = jsonDecode(source, source + strlen(source), &endptr, &person, allocator, flags) == JSON_OK &&
+              person.name.length == 9 && !memcmp(person.name.data, "Ann \0 Lee", 9) && person.id == 9007199254740993 &&
+              person.score == 3 && person.ratio == 0.5f && person.active && person.age == 41 && !strcmp(person.address.city, "NYC") &&
+              person.address.zip == 10001 && person.tags.getTag() == JSON_ARRAY && person.tags.size() == 2 &&
+              !strcmp(person.tags.at(0)->value.toString(), "a") && person.tags.at(1)->value.toNode()->value.getTag() == JSON_NULL;
+
+    Person kept = {};
+    kept.id = 7;
+    ok = ok && decode(R"json({"id": null, "address": null, "tags": null})json", &kept, flags) == JSON_OK && kept.id == 7 && kept.tags.getTag() == JSON_NULL;
+    ok = ok && decode(R"json({"id": 1.5})json", &kept, flags) == JSON_TYPE_MISMATCH && decode(R"json({"years": 3000000000})json", &kept, flags) == JSON_TYPE_MISMATCH &&
+         decode(R"json({"address": []})json", &kept, flags) == JSON_TYPE_MISMATCH && decode(R"json({"address": {"city": 1}})json", &kept, flags) == JSON_TYPE_MISMATCH &&
+         decode(R"json({"active": 1})json", &kept, flags) == JSON_TYPE_MISMATCH && decode(R"json([1])json", &kept, flags) == JSON_TYPE_MISMATCH &&
+         decode(R"json("x")json", &kept, flags) == JSON_TYPE_MISMATCH && decode(R"json({"name": "x",})json", &kept, flags) == JSON_OK &&
+         decode(R"json({"name": "x")json", &kept, flags) == JSON_BREAKING_BAD && kept.id == 7;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: decoding\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+struct StatsHook {
+    int calls;
+    int status;
+};
+
+static void statsHook(const JsonStats &, int status, uint64_t, void *context) {
+    StatsHook *hook = (StatsHook *)context;
+    hook->calls++;
+    hook->status = status;
+}
+
+// Counters of two parses, one failing, and of allocator; all zero without JSON_STATS
+void stats(int flags) {
+    const char *csource = R"json({"a": [1, "x\ny", true], "b": {"c": null}})json";
+    char *source = strdup(csource);
+    char bad[] = "[1,}";
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator(64, 64);
+    StatsHook hook = {0, JSON_OK};
+    JsonStats stats(statsHook, &hook);
+    allocator.setStats(&stats);
+    int result = jsonParse(source, &endptr, &value, allocator, flags);
+    int badResult = jsonParse(bad, bad + strlen(bad), &endptr, &value, allocator, flags);
+    allocator.allocate(1000);
+    bool ok = result == JSON_OK && badResult == JSON_MISMATCH_BRACKET;
+#if JSON_STATS
+    JsonTag number = flags & JSON_PARSE_INTEGERS ? JSON_INTEGER : JSON_NUMBER;
+    ok = ok && stats.parses == 2 && stats.failures == 1 && hook.calls == 2 && hook.status == JSON_MISMATCH_BRACKET &&
+         stats.bytes == strlen(csource) + 3 && stats.values[number] == 2 && stats.values[JSON_STRING] == 1 &&
+         stats.values[JSON_ARRAY] == 1 && stats.values[JSON_OBJECT] == 2 && stats.values[JSON_TRUE] == 1 &&
+         stats.values[JSON_NULL] == 1 && stats.keys == 3 && stats.escapes == 1 && stats.maxDepth == 2 && stats.zones >= 2 &&
+         stats.oversized == 1 && stats.oversizedBytes > 1000;
+#else
+    ok = ok && stats.parses == 0 && stats.bytes == 0 && stats.zones == 0 && hook.calls == 0;
+#endif
+    stats.reset();
+    ok = ok && stats.parses == 0 && stats.values[JSON_OBJECT] == 0 && stats.hook == statsHook;
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: stats\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+// Nesting of depth levels, arrays and objects by turns, innermost holds depth
+static char *nested(int depth) {
+    char *source = (char *)malloc(depth * 8 + 16);
+    char *s = source;
+    for (int i = 0; i < depth; ++i)
+        s += sprintf(s, i % 2 ? "{\"k\":" : "[");
+    s += sprintf(s, "%d", depth);
+    for (int i = depth; i-- > 0;)
+        *s++ = i % 2 ? '}' : ']';
+    *s = 0;
+    return source;
+}
+
+// Levels past the in-place ones move to heap mid-parse, limit counts levels exactly
+void deep(int depth, int flags, int expected) {
+    char *source = nested(depth);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse(source, source + strlen(source), &endptr, &value, allocator, flags | JSON_PARSE_NONDESTRUCTIVE);
+    int levels = 0;
+    for (; result == JSON_OK && value.getTag() != JSON_NUMBER; ++levels)
+        value = value.toNode()->value;
+    if (result != expected || (result == JSON_OK && (levels != depth || value.toNumber() != depth))) {
+        fprintf(stderr, "FAILED %d: deep %d %s\n", parsed, depth, jsonStrError(result));
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+// Strings full of commas and brackets, so cuts in the wrong place break the result.
+// Bytes after the array must stay intact, bad element must fail at the same place.
+void parallelArray(size_t bad, int flags) {
+    size_t size = 0, elements = 50000;
+    char *source = (char *)malloc(elements * 96);
+    source[size++] = '[';
+    for (size_t i = 0; i < elements; ++i) {
+        const char *format = i % 3 ? "{\"id\": %zu, \"tags\": [\"a,]\", \"\\\\\", \"\\\"],[\"]}, " : "[%zu, \"}\\\\\\\",{\", [[]], {}], ";
+        size += sprintf(source + size, i == bad ? "{\"id\": %zu, ]" : format, i);
+    }
+    size += sprintf(source + size, "\"end\"] [1, {\"x\": \"y\"}]");
+    char *copy = (char *)malloc(size);
+    memcpy(copy, source, size);
+    char *original = (char *)malloc(size);
+    memcpy(original, source, size);
+
+    char *expectedEnd, *endptr;
+    JsonValue expected, value;
+    JsonAllocator allocator;
+    JsonParallelParser parser(4);
+    int expectedResult = jsonParse(source, source + size, &expectedEnd, &expected, allocator, flags);
+    int result = parser.parseArray(copy, copy + size, &endptr, &value, flags);
+    bool ok = result == expectedResult && endptr - copy == expectedEnd - source && (bad < elements) == (result != JSON_OK);
+    if (ok && !result)
+        ok = equal(value, expected) && !memcmp(endptr, original + (endptr - copy), copy + size - endptr);
+    if (!ok) {
+        fprintf(stderr, "FAILED %d: parallel array %d\n", parsed, flags);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+    free(copy);
+    free(original);
+}
+
+void number(const char *csource, double expected) {
+    char *source = strdup(csource);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse(source, &endptr, &value, allocator);
+    if (result || value.toNumber() != expected) {
+        fprintf(stderr, "FAILED %d: %s\n%.17g != %.17g\n", parsed, csource, result ? 0.0 : value.toNumber(), expected);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+void integer(const char *csource, int64_t expected) {
+    char *source = strdup(csource);
+    char *endptr;
+    JsonValue value;
+    JsonAllocator allocator;
+    int result = jsonParse(source, &endptr, &value, allocator, JSON_PARSE_INTEGERS);
+    if (result || value.getTag() != JSON_INTEGER || value.toInteger() != expected) {
+        fprintf(stderr, "FAILED %d: %s\n", parsed, csource);
+        ++failed;
+    }
+    ++parsed;
+    free(source);
+}
+
+void allocate() {
+    JsonAllocator allocator(64, 256);
+    char *small = (char *)allocator.allocate(8);
+    char *big = (char *)allocator.allocate(1000);
+    char *next = (char *)allocator.allocate(8);
+    // oversized blocks don't interrupt bumping inside current zone
+    if (!small || !big || next != small + 8) {
+        fprintf(stderr, "FAILED %d: allocate\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+
+    char *reserved = allocator.reserve(4096) ? (char *)allocator.allocate(8) : nullptr;
+    if (!reserved || (char *)allocator.allocate(4000) != reserved + 8) {
+        fprintf(stderr, "FAILED %d: reserve\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+
+    // everything allocated above fits one zone after reset
+    allocator.reset();
+    char *first = (char *)allocator.allocate(8);
+    allocator.allocate(5000);
+    allocator.reset();
+    if (!first || (char *)allocator.allocate(8) != first || (char *)allocator.allocate(5000) != first + 8) {
+        fprintf(stderr, "FAILED %d: reset\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+
+    char stack[256];
+    JsonAllocator buffered(stack, sizeof(stack));
+    char *inside = (char *)buffered.allocate(100);
+    char *spilled = (char *)buffered.allocate(200);
+    if (!(inside >= stack && inside + 100 <= stack + sizeof(stack)) || !spilled || (spilled >= stack && spilled < stack + sizeof(stack))) {
+        fprintf(stderr, "FAILED %d: buffer\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+    buffered.reset();
+    buffered.deallocate();
+    if ((char *)buffered.allocate(100) != inside) {
+        fprintf(stderr, "FAILED %d: buffer deallocate\n", parsed);
+        ++failed;
+    }
+    ++parsed;
+
+    JsonAllocator mapped(JSON_HUGE_PAGE_SIZE, JSON_HUGE_PAGE_SIZE * 4, jsonMmapBacking);
+    char *huge = (char *)mapped.allocate(JSON_HUGE_PAGE_SIZE * 3);
+    char *zone = (char *)mapped.allocate(1000);
+    if (!huge || !zone) {
+        fprintf(stderr, "FAILED %d: mmap\n", parsed);
+        ++failed;
+    } else {
+        memset(huge, 0, JSON_HUGE_PAGE_SIZE * 3);
+        memset(zone, 0, 1000);
+    }
+    ++parsed;
+}
+
 #define pass(csource) parse(csource, true)
 #define fail(csource) parse(csource, false)
 
@@ -50,7 +1062,7 @@ int main() {
       fail(u8R"json(["Illegal backslash escape: \x15"])json");
       fail(u8R"json([\naked])json");
       fail(u8R"json(["Illegal backslash escape: \017"])json");
-      fail(u8R"json([[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[["Too deep"]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]])json");
+      pass(u8R"json([[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[["Too deep"]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]])json");
       pass(u8R"json({"Missing colon" null})json");
       fail(u8R"json({"Unfinished object"})json");
       fail(u8R"json({"Unfinished object 2" null "x"})json");
@@ -64,6 +1076,16 @@ int main() {
 break"])json");
       fail(u8R"json(["line\
 break"])json");
+      fail(u8R"json(["Unterminated string)json");
+      fail(u8R"json({"Unterminated": "string)json");
+      terminator();
+      embedded("[1\0]");
+      embedded("[true\0]");
+      embedded("[\"a\"\0]");
+      embedded("{\"a\":1\0}");
+      embedded("{\"a\":1\0,\"b\":2}");
+      embedded("[1,\0 2]");
+      embedded("\"\\\"d83\0n\"");
       pass(u8R"json([0e])json");
       pass(u8R"json([0e+])json");
       fail(u8R"json([0e+-1])json");
@@ -71,6 +1093,10 @@ break"])json");
       fail(u8R"json(["mismatch"})json");
       pass(u8R"json([[[[[[[[[[[[[[[[[[["Not too deep"]]]]]]]]]]]]]]]]]]])json");
       pass(u8R"json([1, 2, "хУй", [[0.5], 7.11, 13.19e+1], "ba\u0020r", [ [ ] ], -0, -.666, [true, null], {"WAT?!": false}])json");
+      pass(u8R"json(["a string which is long enough to be scanned in several sixteen or thirty two byte blocks"])json");
+      pass(u8R"json(["a string which is long enough to be scanned in several blocks \"before\" the escape \u0041"])json");
+      fail(u8R"json(["a string which is long enough to be scanned in several blocks before the	tab"])json");
+      fail("[\"a string which is long enough to be scanned in several blocks before the \x7F DEL\"]");
       pass(u8R"json({
     "JSON Test Pattern pass3": {
         "The outermost value": "must be an object or array.",
@@ -137,10 +1163,82 @@ break"])json");
 1e00,2e+00,2e-00
 ,"rosebud"])json");
 
+    number("0.1", 0.1);
+    number("-65.613616999999977", -65.613616999999977);
+    number("9007199254740993", 9007199254740993.0);
+    number("2.2250738585072011e-308", 2.2250738585072011e-308);
+    number("4.9e-324", 4.9e-324);
+    number("1.7976931348623157e308", 1.7976931348623157e308);
+    number("1e23", 1e23);
+    number("123456789012345678901234567890", 123456789012345678901234567890.0);
+    number("0.000000000000000000000000000000000000000000001e-280", 0);
+    number("1e-21474836311", 0);
+
+    integer("0", 0);
+    integer("-1", -1);
+    integer("35184372088831", 35184372088831);
+    integer("-35184372088832", -35184372088832);
+    integer("35184372088832", 35184372088832);
+    integer("9007199254740993", 9007199254740993);
+    integer("9223372036854775807", INT64_MAX);
+    integer("-9223372036854775808", INT64_MIN);
+    number("9223372036854775808", 9223372036854775808.0);
+    number("12345678901234567890", 12345678901234567890.0);
+
+    allocate();
+    nondestructive();
+    streaming();
+    // unterminated object eats the next line, unless every line is a document
+    const int concatenated[] = {JSON_OK, JSON_OK, JSON_UNQUOTED_KEY, JSON_OK, JSON_OK};
+    documents(0, 5, concatenated);
+    documents(JSON_PARSE_INDEXED, 5, concatenated);
+    const int lines[] = {JSON_OK, JSON_OK, JSON_BREAKING_BAD, JSON_OK, JSON_UNEXPECTED_CHARACTER};
+    documents(JSON_PARSE_LINES, 5, lines);
+    parallel();
+    parallelArray(-1, 0);
+    parallelArray(-1, JSON_PARSE_INDEXED | JSON_PARSE_INTEGERS);
+    parallelArray(-1, JSON_PARSE_NONDESTRUCTIVE);
+    parallelArray(-1, JSON_PARSE_CONTIGUOUS);
+    parallelArray(31337, 0);
+    contiguous();
+    find(0);
+    find(JSON_PARSE_CONTIGUOUS);
+    intern(0);
+    intern(JSON_PARSE_NONDESTRUCTIVE);
+    intern(JSON_PARSE_CONTIGUOUS | JSON_PARSE_INDEXED);
+    lazy();
+    query();
+    snapshot(JSON_PARSE_INTEGERS);
+    snapshot(JSON_PARSE_CONTIGUOUS);
+    clone(0);
+    clone(JSON_PARSE_INTEGERS | JSON_PARSE_CONTIGUOUS);
+    lengths(0);
+    lengths(JSON_PARSE_INDEXED | JSON_PARSE_CONTIGUOUS);
+    lengths(JSON_PARSE_INTERN_KEYS | JSON_PARSE_NONDESTRUCTIVE);
+    mutation(0);
+    mutation(JSON_PARSE_CONTIGUOUS | JSON_PARSE_INTEGERS);
+    building(0);
+    building(JSON_PARSE_CONTIGUOUS);
+    decoding(0);
+    decoding(JSON_PARSE_INDEXED | JSON_PARSE_CONTIGUOUS);
+    stats(0);
+    stats(JSON_PARSE_INTEGERS | JSON_PARSE_INDEXED);
+    writer(0);
+    writer(JSON_PARSE_INTEGERS | JSON_PARSE_CONTIGUOUS);
+    doubles();
+    deep(JSON_MAX_DEPTH, 0, JSON_OK);
+    deep(JSON_MAX_DEPTH + 1, 0, JSON_STACK_OVERFLOW);
+    deep(32767, JSON_PARSE_MAX_DEPTH(32767), JSON_OK);
+    deep(20000, JSON_PARSE_MAX_DEPTH(20000) | JSON_PARSE_CONTIGUOUS | JSON_PARSE_INDEXED, JSON_OK);
+    deep(11, JSON_PARSE_MAX_DEPTH(10), JSON_STACK_OVERFLOW);
+    deep(10, JSON_PARSE_MAX_DEPTH(10), JSON_OK);
+    sax(0);
+    sax(JSON_PARSE_INTEGERS | JSON_PARSE_INDEXED);
+
     if (failed)
         fprintf(stderr, "%d/%d TESTS FAILED\n", failed, parsed);
     else
         fprintf(stderr, "ALL TESTS PASSED\n");
 
-    return 0;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }